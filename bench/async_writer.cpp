@@ -0,0 +1,166 @@
+#include "stc_async_writer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <ostream>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Measures how long a thread spends writing a colored line to a slow
+// terminal: directly, flushing every line like a line buffered stream, and
+// through stc::async_writer with each backpressure policy. The terminal is a
+// pipe read 1 KB at a time, about 5 MB/s, that stalls for 20 ms every 100 ms
+// like a congested SSH session. Lines are written at a steady 1.5 MB/s.
+
+using clock_type = std::chrono::steady_clock;
+
+// writes every flush straight to the file descriptor
+class fd_buffer : public std::streambuf {
+public:
+  explicit fd_buffer(int fd) : fd(fd) { setp(buffer, buffer + sizeof(buffer)); }
+  ~fd_buffer() override { fd_buffer::sync(); }
+
+protected:
+  int_type overflow(int_type c) override {
+    sync();
+    if (!traits_type::eq_int_type(c, traits_type::eof()))
+      sputc(traits_type::to_char_type(c));
+    return traits_type::not_eof(c);
+  }
+  int sync() override {
+    const char *data = pbase();
+    while (data != pptr()) {
+      const ssize_t written = ::write(fd, data, (size_t)(pptr() - data));
+      if (written < 0)
+        return -1;
+      data += written;
+    }
+    setp(buffer, buffer + sizeof(buffer));
+    return 0;
+  }
+
+private:
+  int fd;
+  char buffer[4096];
+};
+
+class slow_terminal {
+public:
+  int fds[2];
+
+  slow_terminal() {
+    if (::pipe(fds) != 0)
+      std::abort();
+#ifdef F_SETPIPE_SZ
+    ::fcntl(fds[1], F_SETPIPE_SZ, 4096);
+#endif
+    reader = std::thread([this]() { read_slowly(); });
+  }
+  slow_terminal(const slow_terminal &) = delete;
+  slow_terminal &operator=(const slow_terminal &) = delete;
+
+  // closes the pipe, returns the bytes received once all are read
+  size_t close() {
+    ::close(fds[1]);
+    reader.join();
+    ::close(fds[0]);
+    return received;
+  }
+
+private:
+  std::thread reader;
+  size_t received = 0;
+
+  void read_slowly() {
+    char buffer[1024];
+    const auto start = clock_type::now();
+    ssize_t size;
+    while ((size = ::read(fds[0], buffer, sizeof(buffer))) > 0) {
+      received += (size_t)size;
+      const std::chrono::duration<double, std::milli> elapsed =
+          clock_type::now() - start;
+      std::this_thread::sleep_for((long)elapsed.count() % 100 < 20
+                                      ? std::chrono::microseconds(20000)
+                                      : std::chrono::microseconds(200));
+    }
+  }
+};
+
+void write_line(std::ostream &os, int line) {
+  os << stc::rgb_fg(95, 21, 191) << "[frame " << line << "]" << stc::reset
+     << " rendered " << stc::code_fg(34) << "ok" << stc::reset
+     << " in 16 ms\n";
+}
+
+// writes lines at a steady rate, returns the latency of each write in
+// microseconds, counted from when it was due so that the writes held up by a
+// blocked one count as late as well
+template <class FLUSH>
+std::vector<double> write_lines(std::ostream &os, int lines, FLUSH flush) {
+  std::vector<double> latencies;
+  latencies.reserve((size_t)lines);
+  const auto interval = std::chrono::microseconds(40);
+  auto next = clock_type::now();
+  for (int line = 0; line < lines; line++) {
+    const auto due = next;
+    next += interval;
+    while (clock_type::now() < due) {
+    }
+    write_line(os, line);
+    flush();
+    const std::chrono::duration<double, std::micro> elapsed =
+        clock_type::now() - due;
+    latencies.push_back(elapsed.count());
+  }
+  return latencies;
+}
+
+void print_row(const char *name, std::vector<double> latencies,
+               size_t written, size_t discarded) {
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile = [&](double p) {
+    return latencies[(size_t)(p * (double)(latencies.size() - 1))];
+  };
+  std::printf("%-16s %9.2f %9.2f %9.2f %9.2f %10.1f %10zu %10zu\n", name,
+              percentile(0.5), percentile(0.9), percentile(0.99),
+              percentile(0.999), latencies.back(), written, discarded);
+}
+
+int main() {
+  const int lines = 50000;
+  std::printf("%-16s %9s %9s %9s %9s %10s %10s %10s\n", "latency (us)", "p50",
+              "p90", "p99", "p99.9", "max", "written", "discarded");
+  {
+    slow_terminal terminal;
+    std::vector<double> latencies;
+    {
+      fd_buffer buffer(terminal.fds[1]);
+      std::ostream os(&buffer);
+      latencies = write_lines(os, lines, [&]() { os.flush(); });
+    }
+    print_row("direct", latencies, terminal.close(), 0);
+  }
+  const struct {
+    const char *name;
+    stc::async_writer::backpressure policy;
+  } policies[] = {{"async/block", stc::async_writer::BLOCK},
+                  {"async/drop", stc::async_writer::DROP},
+                  {"async/coalesce", stc::async_writer::COALESCE}};
+  for (const auto &policy : policies) {
+    slow_terminal terminal;
+    std::vector<double> latencies;
+    size_t discarded;
+    {
+      stc::async_writer writer(terminal.fds[1], 1 << 16, policy.policy);
+      std::ostream os(&writer);
+      latencies = write_lines(os, lines, []() {});
+      writer.drain();
+      discarded = writer.discarded();
+    }
+    print_row(policy.name, latencies, terminal.close(), discarded);
+  }
+  return 0;
+}
@@ -0,0 +1,33 @@
+// A translation unit that evaluates many colors, styles and markup strings
+// at compile time, as a program with a constexpr color scheme would.
+#include "stc.hpp"
+#include <utility>
+
+template <int I>
+constexpr auto hue_fg = stc::hsl_fg((float)I / 64, 0.8F, 0.5F);
+template <int I>
+constexpr auto hue_bg = stc::hsv_bg((float)I / 64, 0.6F, 0.4F);
+template <int I>
+constexpr auto rgb = stc::rgb_fg((I * 37) % 256, (I * 91) % 256,
+                                 (I * 53) % 256);
+template <int I>
+constexpr auto perceptual = stc::rgb_fg<stc::PERCEPTUAL>(
+    (I * 29) % 256, (I * 71) % 256, (I * 113) % 256);
+template <int I>
+constexpr stc::style styled =
+    hue_fg<I> | hue_bg<I> | stc::attribute<stc::bold>;
+
+template <int... I> constexpr int checksum(std::integer_sequence<int, I...>) {
+  return (0 + ... +
+          (hue_fg<I>.code + hue_bg<I>.code + rgb<I>.code + perceptual<I>.code +
+           (int)styled<I>.sequence(stc::TRUE_COLOR).size()));
+}
+
+constexpr auto banner = stc::markup(
+    "[bold][fg:#5f15bf]stc[reset] [fg:hsl(0.3,1,0.5)]ok[reset] "
+    "[bg:rgb(12,34,56)][fg:200]warning[reset] [underline][fg:#ff8800]note");
+
+static_assert(checksum(std::make_integer_sequence<int, 64>{}) > 0);
+static_assert(banner.sequence(stc::TRUE_COLOR).size() > 0);
+
+int main() { return 0; }
@@ -0,0 +1,4 @@
+// The baseline of the compile time benchmark: only the header.
+#include "stc.hpp"
+
+int main() { return 0; }
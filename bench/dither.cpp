@@ -0,0 +1,84 @@
+#include "stc_dither.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+// Measures stc::dither_256 on a 1920x1080 image with 1, 2, 4, ... threads up
+// to the number of cores (or the count given as argument), against plain
+// stc::quantize_256, and checks that the codes are the same for every thread
+// count.
+
+template <class FUNCTION> double milliseconds_per_call(FUNCTION f) {
+  double best = 0;
+  for (int run = 0; run < 5; run++) {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    const std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (run == 0 || elapsed.count() < best)
+      best = elapsed.count();
+  }
+  return best;
+}
+
+int main(int argc, char **argv) {
+  const size_t width = 1920, height = 1080;
+  // smooth gradients with a little noise, like a photo of the sky
+  std::vector<uint8_t> image(width * height * 3);
+  uint32_t state = 12345;
+  for (size_t y = 0; y < height; y++)
+    for (size_t x = 0; x < width; x++) {
+      state = (state * 1103515245U) + 12345U;
+      const int noise = (int)((state >> 16) % 5) - 2;
+      uint8_t *pixel = image.data() + ((y * width + x) * 3);
+      pixel[0] = (uint8_t)std::max(0, (int)(x * 200 / width) + noise);
+      pixel[1] = (uint8_t)std::max(0, (int)(y * 180 / height) + noise);
+      pixel[2] = (uint8_t)(255 - (x * 100 / width));
+    }
+  const double pixels = (double)(width * height);
+
+  std::vector<uint8_t> codes(width * height);
+  const double plain = milliseconds_per_call(
+      [&]() { stc::quantize_256(image.data(), width * height, codes.data()); });
+  std::printf("%-16s %8s %10s %12s %8s\n", "method", "threads", "ms",
+              "Mpixel/s", "speedup");
+  std::printf("%-16s %8d %10.2f %12.1f\n", "quantize_256", 1, plain,
+              pixels / plain / 1000);
+
+  std::vector<unsigned> thread_counts;
+  const unsigned cores =
+      argc > 1 ? (unsigned)std::max(1, std::atoi(argv[1]))
+               : std::max(1U, std::thread::hardware_concurrency());
+  for (unsigned threads = 1; threads < cores; threads *= 2)
+    thread_counts.push_back(threads);
+  thread_counts.push_back(cores);
+
+  const struct {
+    const char *name;
+    stc::dither_method method;
+  } methods[] = {{"bayer", stc::BAYER},
+                 {"floyd_steinberg", stc::FLOYD_STEINBERG}};
+  for (const auto &method : methods) {
+    std::vector<uint8_t> reference(width * height);
+    stc::dither_256(image.data(), width, height, reference.data(),
+                    method.method);
+    double single = 0;
+    for (const unsigned threads : thread_counts) {
+      stc::thread_pool pool(threads);
+      const double ms = milliseconds_per_call([&]() {
+        stc::dither_256(image.data(), width, height, codes.data(),
+                        method.method, pool);
+      });
+      if (threads == 1)
+        single = ms;
+      std::printf("%-16s %8u %10.2f %12.1f %7.2fx\n", method.name, threads, ms,
+                  pixels / ms / 1000, single / ms);
+      if (codes != reference)
+        std::printf("codes differ from the single threaded ones\n");
+    }
+  }
+  return 0;
+}
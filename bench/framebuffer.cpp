@@ -0,0 +1,114 @@
+#include "stc_framebuffer.hpp"
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Measures the bytes written and the time spent per frame by
+// stc::framebuffer::present, against reprinting the whole screen with
+// operator<<.
+
+template <class FUNCTION> double nanoseconds_per_call(int calls, FUNCTION f) {
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < calls; i++)
+    f(i);
+  const std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / calls;
+}
+
+// a dashboard with a static layout and a few values changing per frame
+void draw_dashboard(stc::framebuffer &screen, int frame) {
+  constexpr stc::style label =
+      stc::rgb_fg(95, 21, 191) | stc::attribute<stc::bold>;
+  static const std::vector<stc::style> bars = [] {
+    std::vector<stc::style> styles;
+    for (int code = 0; code < 16; code++)
+      styles.emplace_back(stc::code_fg(code));
+    return styles;
+  }();
+  for (int row = 0; row < screen.height(); row++) {
+    screen.print(0, row, "worker", label);
+    const int load = (row * 7 + frame) % 100;
+    const std::string value = std::to_string(row % 5 == frame % 5 ? load : row);
+    screen.print(8, row, value, stc::hsl_fg((float)load / 100, 1, 0.5F));
+    for (int column = 12; column < screen.width(); column++)
+      screen.print(column, row, column - 12 < row ? "#" : ".",
+                   bars[column % 16]);
+  }
+}
+
+// what the dashboard costs when reprinted through operator<<
+std::string print_dashboard(int width, int height, int frame) {
+  constexpr stc::style label =
+      stc::rgb_fg(95, 21, 191) | stc::attribute<stc::bold>;
+  std::ostringstream os;
+  os << "\033[H";
+  for (int row = 0; row < height; row++) {
+    const int load = (row * 7 + frame) % 100;
+    os << stc::reset << label << "worker" << stc::reset << "  "
+       << stc::hsl_fg((float)load / 100, 1, 0.5F)
+       << (row % 5 == frame % 5 ? load : row) << stc::reset;
+    for (int column = 12; column < width; column++)
+      os << stc::code_fg(column % 16) << (column - 12 < row ? "#" : ".");
+    os << stc::reset << '\n';
+  }
+  return os.str();
+}
+
+int main() {
+  const int width = 160, height = 48, frames = 2000;
+  std::string output;
+  size_t bytes = 0;
+
+  stc::framebuffer screen(width, height);
+  draw_dashboard(screen, 0);
+  screen.present(output, stc::COLOR_256);
+  const size_t first_frame = output.size();
+  double draw_ns = 0;
+  const double dashboard_ns = nanoseconds_per_call(frames, [&](int frame) {
+    draw_ns += nanoseconds_per_call(
+        1, [&](int) { draw_dashboard(screen, frame + 1); });
+    output.clear();
+    screen.present(output, stc::COLOR_256);
+    bytes += output.size();
+  });
+  draw_ns /= frames;
+  size_t reprint_bytes = 0;
+  const double reprint_ns = nanoseconds_per_call(frames / 10, [&](int frame) {
+    reprint_bytes += print_dashboard(width, height, frame + 1).size();
+  });
+  std::printf("dashboard %dx%d: first frame %zu bytes\n", width, height,
+              first_frame);
+  std::printf("  framebuffer: %10.0f ns/frame %8zu bytes/frame "
+              "(%.0f ns drawing)\n",
+              dashboard_ns, bytes / frames, draw_ns);
+  std::printf("  reprint:     %10.0f ns/frame %8zu bytes/frame\n", reprint_ns,
+              reprint_bytes / (frames / 10));
+
+  // half-block pixels: a moving gradient image, 2 pixels per cell
+  std::vector<uint8_t> pixels((size_t)width * height * 2 * 3);
+  bytes = 0;
+  draw_ns = 0;
+  const double image_ns = nanoseconds_per_call(frames / 10, [&](int frame) {
+    for (int y = 0; y < height * 2; y++)
+      for (int x = 0; x < width; x++) {
+        uint8_t *pixel = &pixels[(((size_t)y * width) + x) * 3];
+        pixel[0] = (uint8_t)(x + frame), pixel[1] = (uint8_t)(y * 2);
+        pixel[2] = (uint8_t)(128 + (x - y) / 2);
+      }
+    draw_ns += nanoseconds_per_call(1, [&](int) {
+      screen.draw_pixels(0, 0, pixels.data(), width, height * 2);
+    });
+    output.clear();
+    screen.present(output, stc::TRUE_COLOR);
+    bytes += output.size();
+  });
+  std::printf("half-block image %dx%d pixels, true color:\n", width,
+              height * 2);
+  std::printf("  framebuffer: %10.0f ns/frame %8zu bytes/frame "
+              "(%.0f ns drawing)\n",
+              image_ns, bytes / (frames / 10), draw_ns / (frames / 10));
+  return 0;
+}
@@ -0,0 +1,351 @@
+#include "stc.hpp"
+#include "stc_highlight.hpp"
+#include "stc_quantize.hpp"
+#include "stc_table.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Measures the hot paths of the library: colors created at runtime, writing
+// colors, styles and manipulators to a stream in every color mode, text
+// layout, keyword highlighting and the compile time of constexpr-heavy
+// sources (built with CMake, which passes the compiler command). Prints a
+// table, "--json FILE" also writes the results as JSON to compare them
+// between releases.
+
+// discards the output
+class null_buffer : public std::streambuf {
+protected:
+  int_type overflow(int_type c) override { return traits_type::not_eof(c); }
+  std::streamsize xsputn(const char *, std::streamsize size) override {
+    return size;
+  }
+};
+
+class result {
+public:
+  std::string name;
+  double value;
+  const char *unit;
+};
+
+// keeps computed values alive without the optimizer seeing them used
+volatile unsigned sink;
+
+// the best of 5 runs of at least 50 ms, in nanoseconds per operation, where
+// a call of f performs operations operations
+template <class FUNCTION>
+double nanoseconds_per_operation(size_t operations, FUNCTION f) {
+  double best = 0;
+  for (int run = 0; run < 5; run++) {
+    const auto start = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::nano> elapsed{};
+    size_t calls = 0;
+    do {
+      f();
+      calls++;
+      elapsed = std::chrono::steady_clock::now() - start;
+    } while (elapsed < std::chrono::milliseconds(50));
+    const double per_operation = elapsed.count() / (double)(calls * operations);
+    if (run == 0 || per_operation < best)
+      best = per_operation;
+  }
+  return best;
+}
+
+// pseudo random inputs, so that nothing is computed at compile time
+class inputs {
+public:
+  static constexpr size_t count = 4096;
+  std::vector<int> rgb;
+  std::vector<uint8_t> pixels;
+  std::vector<float> hsl;
+
+  inputs() : rgb(count * 3), pixels(count * 3), hsl(count * 3) {
+    uint32_t state = 12345;
+    auto next = [&]() {
+      state = (state * 1103515245U) + 12345U;
+      return (state >> 8) & 0xFFFF;
+    };
+    for (size_t i = 0; i < count * 3; i++) {
+      rgb[i] = (int)(next() % 256);
+      pixels[i] = (uint8_t)rgb[i];
+      hsl[i] = (float)next() / 65536;
+    }
+  }
+};
+
+void bench_color_creation(const inputs &in, std::vector<result> &results) {
+  const int *rgb = in.rgb.data();
+  const float *hsl = in.hsl.data();
+  const size_t n = inputs::count;
+  auto add = [&](const char *name, auto f) {
+    results.push_back({name, nanoseconds_per_operation(n, f), "ns/op"});
+  };
+  add("rgb_fg", [&]() {
+    unsigned sum = 0;
+    for (size_t i = 0; i < n; i++)
+      sum += stc::rgb_fg(rgb[3 * i], rgb[(3 * i) + 1], rgb[(3 * i) + 2]).code;
+    sink = sum;
+  });
+  add("rgb_fg<PERCEPTUAL>", [&]() {
+    unsigned sum = 0;
+    for (size_t i = 0; i < n; i++)
+      sum += stc::rgb_fg<stc::PERCEPTUAL>(rgb[3 * i], rgb[(3 * i) + 1],
+                                          rgb[(3 * i) + 2])
+                 .code;
+    sink = sum;
+  });
+  add("hsl_fg", [&]() {
+    unsigned sum = 0;
+    for (size_t i = 0; i < n; i++)
+      sum += stc::hsl_fg(hsl[3 * i], hsl[(3 * i) + 1], hsl[(3 * i) + 2]).code;
+    sink = sum;
+  });
+  add("hsv_fg", [&]() {
+    unsigned sum = 0;
+    for (size_t i = 0; i < n; i++)
+      sum += stc::hsv_fg(hsl[3 * i], hsl[(3 * i) + 1], hsl[(3 * i) + 2]).code;
+    sink = sum;
+  });
+  std::vector<uint8_t> codes(n);
+  add("quantize_256", [&]() {
+    stc::quantize_256(in.pixels.data(), n, codes.data());
+    sink = codes[n - 1];
+  });
+}
+
+// colors and styles created at runtime, written by the stream benchmarks
+class stream_inputs {
+public:
+  static constexpr size_t count = 256;
+  std::vector<stc::_color_code<true>> colors;
+  std::vector<stc::style> styles;
+
+  explicit stream_inputs(const inputs &in) {
+    for (size_t i = 0; i < count; i++) {
+      const int *rgb = in.rgb.data() + (3 * i);
+      colors.push_back(stc::rgb_fg(rgb[0], rgb[1], rgb[2]));
+      styles.push_back(colors.back() | stc::code_bg((int)i) | stc::bold);
+    }
+  }
+};
+
+// writes to out, a std::ostream or a stc::styled_ostream, the results are
+// named "<what>/<mode>" with the given prefix
+template <class STREAM>
+void bench_writes(STREAM &out, const stream_inputs &in, const char *prefix,
+                  const char *mode_name, std::vector<result> &results) {
+  constexpr auto text = stc::markup("[bold][fg:#5f15bf]Error:[reset] ");
+  const size_t n = stream_inputs::count;
+  auto add = [&](const char *what, size_t operations, auto f) {
+    results.push_back({std::string(prefix) + what + "/" + mode_name,
+                       nanoseconds_per_operation(operations, f), "ns/op"});
+  };
+  add("write_color", n, [&]() {
+    for (const auto &color : in.colors)
+      out << color;
+  });
+  add("write_style", n, [&]() {
+    for (const auto &s : in.styles)
+      out << s;
+  });
+  add("write_markup", n, [&]() {
+    for (size_t i = 0; i < n; i++)
+      out << text;
+  });
+  add("manipulators", 4 * n, [&]() {
+    for (size_t i = 0; i < n; i++)
+      out << stc::bold << stc::underline << stc::reset_fg << stc::reset;
+  });
+}
+
+// the same writes through a stc::styled_ostream, with the mode fixed at
+// compile time
+template <stc::_color_modes MODE>
+void bench_styled_writes(std::ostream &os, const stream_inputs &in,
+                         const char *mode_name, std::vector<result> &results) {
+  stc::styled_ostream<MODE> out(os);
+  bench_writes(out, in, "styled_ostream/", mode_name, results);
+}
+
+void bench_stream_output(const inputs &in, std::vector<result> &results) {
+  const struct {
+    const char *name;
+    stc::_manipulator set_mode;
+  } modes[] = {{"color_256", stc::color_256},
+               {"true_color", stc::true_color},
+               {"no_color", stc::no_color},
+               {"color_16", stc::color_16},
+               {"color_8", stc::color_8}};
+  const stream_inputs writes(in);
+  null_buffer buffer;
+  std::ostream os(&buffer);
+  for (const auto &mode : modes) {
+    os << mode.set_mode;
+    bench_writes(os, writes, "", mode.name, results);
+  }
+  bench_styled_writes<stc::COLOR_256>(os, writes, "color_256", results);
+  bench_styled_writes<stc::TRUE_COLOR>(os, writes, "true_color", results);
+  bench_styled_writes<stc::NO_COLOR>(os, writes, "no_color", results);
+  bench_styled_writes<stc::COLOR_16>(os, writes, "color_16", results);
+  bench_styled_writes<stc::COLOR_8>(os, writes, "color_8", results);
+}
+
+void bench_layout(std::vector<result> &results) {
+  const std::string ascii(4096, 'x');
+  std::ostringstream colored_os;
+  for (int i = 0; (size_t)colored_os.tellp() < 4096; i++)
+    colored_os << stc::rgb_fg(95, 21, 191) << "label " << i << stc::reset
+               << " plain text ";
+  const std::string colored = colored_os.str();
+  std::string wide;
+  while (wide.size() < 4096)
+    wide += "表示幅 ";
+  for (const auto &[name, text] : {std::pair<const char *, const std::string &>(
+                                       "display_width/ascii", ascii),
+                                   {"display_width/colored", colored},
+                                   {"display_width/cjk", wide}})
+    results.push_back({name, nanoseconds_per_operation(text.size(), [&]() {
+                         sink = (unsigned)stc::display_width(text);
+                       }),
+                       "ns/byte"});
+
+  // a 1000 row table with repeated colored status cells
+  std::vector<std::string> statuses;
+  for (const char *status : {"ok", "degraded", "failed"}) {
+    std::ostringstream os;
+    os << stc::rgb_fg(0, 200, 0) << status << stc::reset;
+    statuses.push_back(os.str());
+  }
+  const size_t rows = 1000;
+  auto fill = [&](stc::table &t) {
+    for (size_t row = 0; row < rows; row++)
+      t.add_row({"service-" + std::to_string(row), std::to_string(row * 7),
+                 statuses[row % 3]});
+  };
+  results.push_back({"table/add_row", nanoseconds_per_operation(rows, [&]() {
+                       stc::table t;
+                       fill(t);
+                       sink = (unsigned)t.rows();
+                     }),
+                     "ns/row"});
+  stc::table t;
+  fill(t);
+  std::string output;
+  results.push_back({"table/render", nanoseconds_per_operation(rows, [&]() {
+                       output.clear();
+                       t.render(output, stc::COLOR_256);
+                       sink = (unsigned)output.size();
+                     }),
+                     "ns/row"});
+}
+
+// a log highlighted by 8 keywords, per byte of input
+void bench_highlight(std::vector<result> &results) {
+  std::string log;
+  const char *levels[] = {"INFO", "DEBUG", "WARN", "ERROR"};
+  for (int i = 0; log.size() < 65536; i++)
+    log += std::string(levels[i % 4]) + " req-" + std::to_string(i * 31) +
+           " handled by worker " + std::to_string(i % 8) +
+           (i % 5 == 0 ? " timeout exceeded\n" : " in 12 ms\n");
+  const std::vector<stc::highlight_rule> rules = {
+      {"ERROR", stc::rgb_fg(220, 0, 0) | stc::bold},
+      {"WARN", stc::rgb_fg(230, 180, 0)},
+      {"INFO", stc::rgb_fg(0, 160, 220)},
+      {"DEBUG", stc::code_fg(245)},
+      {"req-", stc::code_fg(51)},
+      {"timeout", stc::underline},
+      {"worker", stc::italic},
+      {"failed", stc::bold}};
+  null_buffer buffer;
+  for (const auto &[name, mode] :
+       {std::pair<const char *, stc::_color_modes>("highlight/true_color",
+                                                   stc::TRUE_COLOR),
+        {"highlight/no_color", stc::NO_COLOR}}) {
+    stc::highlighter h(&buffer, rules, mode);
+    std::ostream os(&h);
+    results.push_back({name, nanoseconds_per_operation(log.size(), [&]() {
+                         os.write(log.data(), (std::streamsize)log.size());
+                         os.flush();
+                       }),
+                       "ns/byte"});
+  }
+}
+
+// the median of 3 compilations of each source, in milliseconds
+void bench_compile_time(std::vector<result> &results) {
+#if defined(STC_BENCH_COMPILE_COMMAND) && defined(STC_BENCH_COMPILE_SOURCES)
+  for (const char *source : {"include_only", "constexpr_heavy"}) {
+    const std::string command = std::string(STC_BENCH_COMPILE_COMMAND) +
+                                " \"" + STC_BENCH_COMPILE_SOURCES + "/" +
+                                source + ".cpp\"";
+    std::vector<double> times;
+    for (int run = 0; run < 3; run++) {
+      const auto start = std::chrono::steady_clock::now();
+      if (std::system(command.c_str()) != 0) {
+        std::fprintf(stderr, "compilation failed: %s\n", command.c_str());
+        return;
+      }
+      const std::chrono::duration<double, std::milli> elapsed =
+          std::chrono::steady_clock::now() - start;
+      times.push_back(elapsed.count());
+    }
+    std::sort(times.begin(), times.end());
+    results.push_back({std::string("compile/") + source, times[1], "ms"});
+  }
+#else
+  (void)results;
+#endif
+}
+
+void write_json(std::FILE *file, const std::vector<result> &results) {
+  std::fprintf(file, "{\n");
+#ifdef __VERSION__
+  std::fprintf(file, "  \"compiler\": \"%s\",\n", __VERSION__);
+#endif
+  std::fprintf(file, "  \"benchmarks\": [\n");
+  for (size_t i = 0; i < results.size(); i++)
+    std::fprintf(file,
+                 "    {\"name\": \"%s\", \"value\": %.3f, "
+                 "\"unit\": \"%s\"}%s\n",
+                 results[i].name.c_str(), results[i].value, results[i].unit,
+                 i + 1 < results.size() ? "," : "");
+  std::fprintf(file, "  ]\n}\n");
+}
+
+int main(int argc, char **argv) {
+  const char *json_path = nullptr;
+  if (argc == 3 && std::string(argv[1]) == "--json") {
+    json_path = argv[2];
+  } else if (argc != 1) {
+    std::fprintf(stderr, "usage: %s [--json FILE]\n", argv[0]);
+    return 2;
+  }
+
+  const inputs in;
+  std::vector<result> results;
+  bench_color_creation(in, results);
+  bench_stream_output(in, results);
+  bench_layout(results);
+  bench_highlight(results);
+  bench_compile_time(results);
+
+  for (const result &r : results)
+    std::printf("%-40s %12.3f %s\n", r.name.c_str(), r.value, r.unit);
+  if (json_path != nullptr) {
+    std::FILE *file = std::fopen(json_path, "w");
+    if (file == nullptr) {
+      std::fprintf(stderr, "can not open %s\n", json_path);
+      return 1;
+    }
+    write_json(file, results);
+    std::fclose(file);
+  }
+  return 0;
+}
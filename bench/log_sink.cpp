@@ -0,0 +1,85 @@
+#include "stc_log_sink.hpp"
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+// Measures colored lines per second written by 1-64 threads through
+// stc::log_sink, against a mutex around a shared stream.
+
+// discards the output, counting the bytes
+class counting_buffer : public std::streambuf {
+public:
+  size_t bytes = 0;
+
+protected:
+  int_type overflow(int_type c) override {
+    bytes++;
+    return traits_type::not_eof(c);
+  }
+  std::streamsize xsputn(const char *, std::streamsize size) override {
+    bytes += (size_t)size;
+    return size;
+  }
+};
+
+void write_line(std::ostream &os, int thread, int line) {
+  os << stc::rgb_fg(95, 21, 191) << "[worker " << thread << "]" << stc::reset
+     << " processed item " << line << ' ' << stc::code_fg(34) << "ok"
+     << stc::reset << '\n';
+}
+
+template <class FUNCTION>
+double lines_per_second(int threads, int lines, FUNCTION write) {
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++)
+    workers.emplace_back([&write, t, lines]() {
+      for (int i = 0; i < lines; i++)
+        write(t, i);
+    });
+  for (auto &worker : workers)
+    worker.join();
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return (double)threads * lines / elapsed.count();
+}
+
+int main() {
+  const int total_lines = 1 << 20;
+  std::printf("%8s %16s %16s\n", "threads", "log_sink lines/s",
+              "mutex lines/s");
+  for (int threads = 1; threads <= 64; threads *= 2) {
+    const int lines = total_lines / threads;
+    counting_buffer sink_output, mutex_output;
+    std::ostream sink_target(&sink_output), mutex_target(&mutex_output);
+
+    double sink_rate = 0;
+    {
+      const auto start = std::chrono::steady_clock::now();
+      {
+        stc::log_sink sink(sink_target);
+        lines_per_second(threads, lines, [&](int thread, int line) {
+          write_line(sink.stream(), thread, line);
+        });
+      } // includes the time to drain the queue
+      const std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+      sink_rate = (double)threads * lines / elapsed.count();
+    }
+
+    std::mutex mutex;
+    const double mutex_rate =
+        lines_per_second(threads, lines, [&](int thread, int line) {
+          const std::lock_guard<std::mutex> lock(mutex);
+          write_line(mutex_target, thread, line);
+        });
+    if (sink_output.bytes != mutex_output.bytes)
+      std::printf("output size differs: %zu vs %zu\n", sink_output.bytes,
+                  mutex_output.bytes);
+    std::printf("%8d %16.0f %16.0f\n", threads, sink_rate, mutex_rate);
+  }
+  return 0;
+}
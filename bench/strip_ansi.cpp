@@ -0,0 +1,90 @@
+#include "stc_strip_ansi.hpp"
+#include <chrono>
+#include <cstdio>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+// Measures the throughput of stc::strip_ansi and stc::strip_ansi_filter on
+// large synthetic logs with different densities of escape sequences.
+
+// discards the output
+class null_buffer : public std::streambuf {
+protected:
+  int_type overflow(int_type c) override { return traits_type::not_eof(c); }
+  std::streamsize xsputn(const char *, std::streamsize size) override {
+    return size;
+  }
+};
+
+// a log of about size bytes where every n-th line has colored parts
+std::string make_log(size_t size, int colored_every) {
+  std::ostringstream os;
+  os << stc::true_color;
+  for (int line = 0; (size_t)os.tellp() < size; line++) {
+    if (colored_every != 0 && line % colored_every == 0)
+      os << stc::rgb_fg(95, 21, 191) << "[worker " << line % 16 << "]"
+         << stc::reset << " processed item " << line << ' '
+         << stc::code_fg(34) << "ok" << stc::reset << '\n';
+    else
+      os << "[worker " << line % 16 << "] processed item " << line
+         << " ok, nothing to report for this one\n";
+  }
+  return os.str();
+}
+
+template <class FUNCTION>
+double gigabytes_per_second(size_t bytes, int repeats, FUNCTION f) {
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < repeats; i++)
+    f();
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return (double)bytes * repeats / elapsed.count() / 1e9;
+}
+
+int main() {
+  const size_t size = 64 << 20;
+  const int repeats = 5;
+  const struct {
+    const char *name;
+    int colored_every;
+  } logs[] = {{"no sequences", 0}, {"1 in 10 lines colored", 10},
+              {"all lines colored", 1}};
+
+  std::printf("%-24s %10s %10s %10s %10s\n", "log (GB/s)", "memchr", "in place",
+              "copy", "streambuf");
+  for (const auto &log : logs) {
+    const std::string input = make_log(size, log.colored_every);
+    std::string work = input, output(input.size(), '\0');
+    size_t checksum = 0;
+
+    const double scan = gigabytes_per_second(input.size(), repeats, [&]() {
+      const char *p = input.data(), *const end = p + input.size();
+      while ((p = static_cast<const char *>(
+                  std::memchr(p, '\033', (size_t)(end - p)))) != nullptr)
+        p++, checksum++;
+    });
+    // in place: the first pass strips, later passes scan the stripped text
+    const double in_place = gigabytes_per_second(input.size(), 1, [&]() {
+      checksum += stc::strip_ansi(work.data(), work.size(), work.data());
+    });
+    const double copy = gigabytes_per_second(input.size(), repeats, [&]() {
+      checksum += stc::strip_ansi(input.data(), input.size(), output.data());
+    });
+    null_buffer sink;
+    const double stream = gigabytes_per_second(input.size(), repeats, [&]() {
+      stc::strip_ansi_filter filter(&sink);
+      std::ostream os(&filter);
+      // written in 4 KiB pieces, as a pipe would deliver them
+      for (size_t i = 0; i < input.size(); i += 4096)
+        os.write(input.data() + i,
+                 (std::streamsize)std::min<size_t>(4096, input.size() - i));
+    });
+    std::printf("%-24s %10.2f %10.2f %10.2f %10.2f\n", log.name, scan,
+                in_place, copy, stream);
+    if (checksum == 0)
+      std::printf("\n");
+  }
+  return 0;
+}
@@ -0,0 +1,33 @@
+#include "stc_dither.hpp"
+#include <iostream>
+#include <vector>
+
+int main() {
+  // a dark blue to teal gradient, where 256 colors band the most
+  const size_t width = 72, height = 3;
+  std::vector<uint8_t> pixels;
+  for (size_t y = 0; y < height; y++)
+    for (size_t x = 0; x < width; x++) {
+      pixels.push_back(0);
+      pixels.push_back((uint8_t)(x * 120 / width));
+      pixels.push_back((uint8_t)(60 + (x * 100 / width)));
+    }
+
+  std::vector<uint8_t> plain(width * height), bayer(width * height),
+      diffused(width * height);
+  stc::quantize_256(pixels.data(), width * height, plain.data());
+  stc::dither_256(pixels.data(), width, height, bayer.data(), stc::BAYER);
+  stc::dither_256(pixels.data(), width, height, diffused.data(),
+                  stc::FLOYD_STEINBERG);
+
+  std::cout << stc::color_256;
+  for (const auto *codes : {&plain, &bayer, &diffused}) {
+    for (size_t y = 0; y < height; y++) {
+      for (size_t x = 0; x < width; x++)
+        std::cout << stc::code_bg((*codes)[(y * width) + x]) << ' ';
+      std::cout << stc::reset << '\n';
+    }
+    std::cout << '\n';
+  }
+  return 0;
+}
@@ -0,0 +1,20 @@
+#include "stc_highlight.hpp"
+#include <iostream>
+
+int main() {
+  std::cout << stc::true_color;
+  {
+    // colors the keywords of everything written to std::cout in its scope
+    stc::highlighter h(std::cout,
+                       {{"ERROR", stc::rgb_fg(220, 0, 0) | stc::bold},
+                        {"WARN", stc::rgb_fg(230, 180, 0)},
+                        {"INFO", stc::rgb_fg(0, 160, 220)},
+                        {"req-", stc::code_fg(245)}});
+    std::cout << "INFO  req-17 accepted\n";
+    std::cout << "WARN  req-17 slow response\n";
+    // a keyword may be split between writes
+    std::cout << "ERR" << "OR req-18 failed\n";
+  }
+  std::cout << "ERROR is no longer highlighted\n";
+  return 0;
+}
@@ -1,4 +1,5 @@
 #include "stc.hpp"
+#include "stc_detect.hpp"
 #include <iostream>
 
 int main(int argc, char **argv) {
@@ -13,6 +14,12 @@ int main(int argc, char **argv) {
     cout << stc::no_color;
   else if (mode == "--true-color")
     cout << stc::true_color;
+  else if (mode == "--16-color")
+    cout << stc::color_16;
+  else if (mode == "--8-color")
+    cout << stc::color_8;
+  else if (mode == "--auto")
+    cout << stc::auto_detect; // from the terminal, none when redirected
   
   // no extra logic needed when printing.
   cout << stc::rgb_fg(0, 0, 0) << stc::hsl_bg(0.8, 0.3, 0.6) << "Hello!" << stc::reset << '\n';
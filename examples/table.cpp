@@ -0,0 +1,26 @@
+#include "stc_table.hpp"
+#include <iostream>
+#include <sstream>
+
+int main() {
+  stc::table t;
+  t.set_style(0, stc::style(stc::bold));
+  t.set_alignment(1, stc::table::RIGHT);
+  t.set_separator(" | ");
+
+  // cells may contain escape sequences, std::setw would count their bytes
+  auto status = [](bool ok) {
+    std::ostringstream os;
+    if (ok)
+      os << stc::rgb_fg(0, 200, 0) << "ok" << stc::reset;
+    else
+      os << stc::rgb_fg(220, 0, 0) << "failed" << stc::reset;
+    return os.str();
+  };
+  t.add_row({"service", "latency", "status"});
+  t.add_row({"api", "12 ms", status(true)});
+  t.add_row({"database", "148 ms", status(false)});
+  t.add_row({"キャッシュ", "3 ms", status(true)}); // two columns per character
+  std::cout << t;
+  return 0;
+}
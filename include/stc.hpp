@@ -23,17 +23,191 @@ SOFTWARE.
 */
 
 #pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
 #include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#if __cplusplus >= 202002L
+#include <span>
+#include <type_traits>
+#endif
 
 namespace stc {
 
-enum _color_modes { COLOR_256 = 0, TRUE_COLOR = 1, NO_COLOR = 2 };
+enum _color_modes {
+  COLOR_256 = 0,
+  TRUE_COLOR = 1,
+  NO_COLOR = 2,
+  COLOR_16 = 3,
+  COLOR_8 = 4
+};
+
+constexpr long _color_mode_count = 5;
 
 inline int _get_color_mode_index() {
   static const int i = std::ios_base::xalloc();
   return i;
 }
 
+// Counters of what the library wrote to a stream, read with stc::stats(os).
+// Counting is opt-in: define STC_ENABLE_STATS before including the library,
+// otherwise the counting functions are empty and all counters stay zero.
+class stream_stats {
+public:
+  enum sequence_type {
+    COLOR,     // colors and gradients
+    STYLE,     // stc::style
+    ATTRIBUTE, // attribute manipulators, e.g. stc::bold
+    MARKUP,    // stc::markup strings with at least one tag
+    sequence_type_count
+  };
+
+  unsigned long long sequences[sequence_type_count]{}; // written, by type
+  unsigned long long escape_bytes = 0; // bytes of the written sequences
+  unsigned long long suppressed = 0;   // sequences not written in NO_COLOR mode
+  // RGB colors matched to color codes while writing (by stc::sgr_transcoder),
+  // and how many of them were found in its cache
+  unsigned long long quantizations = 0, quantization_cache_hits = 0;
+  // every byte written to the stream, counted by a stc::stats_counter
+  unsigned long long total_bytes = 0;
+
+  // bytes that are not escape sequences, if a stc::stats_counter counted
+  // total_bytes from the start
+  unsigned long long payload_bytes() const {
+    return total_bytes > escape_bytes ? total_bytes - escape_bytes : 0;
+  }
+};
+
+constexpr bool stats_enabled =
+#ifdef STC_ENABLE_STATS
+    true;
+#else
+    false;
+#endif
+
+#ifdef STC_ENABLE_STATS
+
+// the counters are allocated on first use and owned by the stream: its
+// pword slot holds them, its iword slot remembers that the callback that
+// deletes them is registered (both are copied together by copyfmt)
+inline void _stats_callback(std::ios_base::event event, std::ios_base &stream,
+                            int index) {
+  void *&slot = stream.pword(index);
+  if (event == std::ios_base::erase_event) {
+    delete static_cast<stream_stats *>(slot);
+  } else if (event == std::ios_base::copyfmt_event) {
+    // a stream that copied the format of another one counts on its own
+    slot = nullptr;
+  }
+}
+
+inline stream_stats *_stats_of(std::ostream &os) {
+  static const int index = std::ios_base::xalloc();
+  void *&slot = os.pword(index);
+  if (slot == nullptr) {
+    if (os.iword(index) == 0) {
+      os.register_callback(_stats_callback, index);
+      os.iword(index) = 1;
+    }
+    slot = new stream_stats;
+  }
+  return static_cast<stream_stats *>(slot);
+}
+
+inline void _count_sequence(std::ostream &os, stream_stats::sequence_type type,
+                            long mode, size_t size) {
+  stream_stats &counters = *_stats_of(os);
+  if (mode == NO_COLOR) {
+    counters.suppressed++;
+  } else if (size != 0) {
+    counters.sequences[type]++;
+    counters.escape_bytes += size;
+  }
+}
+
+inline void _count_quantization(stream_stats *counters, bool cache_hit) {
+  if (counters == nullptr)
+    return;
+  counters->quantizations++;
+  if (cache_hit)
+    counters->quantization_cache_hits++;
+}
+
+#else
+
+inline stream_stats *_stats_of(std::ostream &) { return nullptr; }
+inline void _count_sequence(std::ostream &, stream_stats::sequence_type, long,
+                            size_t) {}
+inline void _count_quantization(stream_stats *, bool) {}
+
+#endif
+
+// the counters of os, all zero unless STC_ENABLE_STATS is defined
+inline const stream_stats &stats(std::ostream &os) {
+#ifdef STC_ENABLE_STATS
+  return *_stats_of(os);
+#else
+  (void)os;
+  static const stream_stats none;
+  return none;
+#endif
+}
+
+inline void reset_stats(std::ostream &os) {
+  if (stream_stats *counters = _stats_of(os))
+    *counters = {};
+}
+
+// A streambuf that counts every byte written to a stream into its
+// stream_stats::total_bytes, so that escape bytes can be compared to the
+// payload:
+//   stc::stats_counter counter(std::cout); // installs itself until destroyed
+// Bytes are passed on as they are written. Without STC_ENABLE_STATS it does
+// not install itself.
+class stats_counter : public std::streambuf {
+public:
+  explicit stats_counter(std::ostream &os) {
+    if (stream_stats *os_counters = _stats_of(os)) {
+      counters = os_counters;
+      target_buf = os.rdbuf();
+      installed_on = &os;
+      os.rdbuf(this);
+    }
+  }
+  stats_counter(const stats_counter &) = delete;
+  stats_counter &operator=(const stats_counter &) = delete;
+  ~stats_counter() override {
+    if (installed_on != nullptr)
+      installed_on->rdbuf(target_buf);
+  }
+
+protected:
+  int_type overflow(int_type c) override {
+    if (traits_type::eq_int_type(c, traits_type::eof()))
+      return traits_type::not_eof(c);
+    counters->total_bytes++;
+    return target_buf->sputc(traits_type::to_char_type(c));
+  }
+  std::streamsize xsputn(const char *data, std::streamsize size) override {
+    const std::streamsize written = target_buf->sputn(data, size);
+    counters->total_bytes += (unsigned long long)written;
+    return written;
+  }
+  int sync() override { return target_buf->pubsync(); }
+
+private:
+  stream_stats *counters = nullptr;
+  std::streambuf *target_buf = nullptr;
+  std::ostream *installed_on = nullptr;
+};
+
 class _color_data {
 public:
   unsigned int r : 8, g : 8, b : 8, code : 8;
@@ -41,32 +215,176 @@ public:
       : r(r), g(g), b(b), code(code){};
 };
 
+// an escape sequence rendered ahead of time, so it can be written at once
+template <size_t CAPACITY> class _basic_sequence {
+  static_assert(CAPACITY < 256);
+
+public:
+  char data[CAPACITY]{};
+  unsigned char size = 0;
+
+  constexpr void append(char c) { data[size++] = c; }
+  constexpr void append(std::string_view text) {
+    for (const char c : text)
+      append(c);
+  }
+  constexpr void append_number(int number) {
+    if (number >= 100)
+      append((char)('0' + (number / 100)));
+    if (number >= 10)
+      append((char)('0' + ((number / 10) % 10)));
+    append((char)('0' + (number % 10)));
+  }
+  constexpr std::string_view view() const { return {data, size}; }
+};
+
+// longest color sequence: "\033[38;2;255;255;255m"
+using _sequence = _basic_sequence<19>;
+
+constexpr _sequence _render_color_sequence(bool is_foreground,
+                                           bool is_true_color, int r, int g,
+                                           int b, int code) {
+  _sequence sequence;
+  sequence.append(is_foreground ? "\033[38;" : "\033[48;");
+  if (is_true_color) {
+    sequence.append("2;");
+    sequence.append_number(r);
+    sequence.append(';');
+    sequence.append_number(g);
+    sequence.append(';');
+    sequence.append_number(b);
+  } else {
+    sequence.append("5;");
+    sequence.append_number(code);
+  }
+  sequence.append('m');
+  return sequence;
+}
+
+class _256color_sequences {
+public:
+  _sequence fg[256]{}, bg[256]{};
+  constexpr _256color_sequences() {
+    for (int code = 0; code < 256; code++) {
+      fg[code] = _render_color_sequence(true, false, 0, 0, 0, code);
+      bg[code] = _render_color_sequence(false, false, 0, 0, 0, code);
+    }
+  }
+};
+
+inline constexpr _256color_sequences _256color_sequence_table{};
+
+// sequences of the 16 system colors: "\033[31m" and bright "\033[91m"
+class _16color_sequences {
+public:
+  _basic_sequence<6> fg[16]{}, bg[16]{};
+  constexpr _16color_sequences() {
+    for (int code = 0; code < 16; code++) {
+      const int offset = code < 8 ? code : 60 + (code - 8);
+      fg[code].append("\033[");
+      fg[code].append_number(30 + offset);
+      fg[code].append('m');
+      bg[code].append("\033[");
+      bg[code].append_number(40 + offset);
+      bg[code].append('m');
+    }
+  }
+};
+
+inline constexpr _16color_sequences _16color_sequence_table{};
+
+// sequence of a palette color in 256, 16 or 8 color mode
+constexpr std::string_view _indexed_color_sequence(bool is_foreground,
+                                                   long mode, int code) {
+  if (mode == _color_modes::COLOR_256)
+    return (is_foreground ? _256color_sequence_table.fg
+                          : _256color_sequence_table.bg)[code]
+        .view();
+  return (is_foreground ? _16color_sequence_table.fg
+                        : _16color_sequence_table.bg)[code]
+      .view();
+}
+
+constexpr void _find_closest_system_color_codes(int r, int g, int b,
+                                                int &code_16, int &code_8);
+
 template <bool IS_FOREGROUND> class _color_code : public _color_data {
-  using _color_data::_color_data;
+public:
+  // 256 color sequences are shared through _256color_sequence_table, the true
+  // color one is rendered with the color (at compile time when constexpr)
+  _sequence true_color_sequence;
+  // closest of the system colors 0 - 15 and 0 - 7, for 16 and 8 color mode,
+  // or no_system_code when they are found from the color as it is written
+  unsigned char code_16 = no_system_code, code_8 = no_system_code;
+
+  static constexpr unsigned char no_system_code = 255;
+
+  constexpr _color_code(int r, int g, int b, int code, int code_16,
+                        int code_8)
+      : _color_data(r, g, b, code),
+        true_color_sequence(_render_color_sequence(
+            IS_FOREGROUND, true, (int)_color_data::r, (int)_color_data::g,
+            (int)_color_data::b, code)),
+        code_16((unsigned char)code_16), code_8((unsigned char)code_8) {}
+  // most colors are only written in 256 or true color mode, so the system
+  // colors are not searched up front
+  constexpr _color_code(int r, int g, int b, int code)
+      : _color_code(r, g, b, code, no_system_code, no_system_code) {}
+
+  // code_16 and code_8, searched for if they were not given
+  constexpr int system_code_16() const {
+    return code_16 != no_system_code ? code_16 : closest_system_codes(true);
+  }
+  constexpr int system_code_8() const {
+    return code_8 != no_system_code ? code_8 : closest_system_codes(false);
+  }
+
+  // escape sequence emitted in the given color mode
+  constexpr std::string_view sequence(long mode) const {
+    if (mode == _color_modes::COLOR_256)
+      return _indexed_color_sequence(IS_FOREGROUND, mode, code);
+    if (mode == _color_modes::TRUE_COLOR)
+      return true_color_sequence.view();
+    if (mode == _color_modes::COLOR_16)
+      return _indexed_color_sequence(IS_FOREGROUND, mode, system_code_16());
+    if (mode == _color_modes::COLOR_8)
+      return _indexed_color_sequence(IS_FOREGROUND, mode, system_code_8());
+    return {};
+  }
+
+private:
+  constexpr int closest_system_codes(bool is_16) const {
+    int closest_16 = 0, closest_8 = 0;
+    _find_closest_system_color_codes((int)_color_data::r, (int)_color_data::g,
+                                     (int)_color_data::b, closest_16,
+                                     closest_8);
+    return is_16 ? closest_16 : closest_8;
+  }
 };
 
+inline std::ostream &_write_sequence(std::ostream &os,
+                                     std::string_view sequence) {
+  if (!sequence.empty())
+    os.write(sequence.data(), (std::streamsize)sequence.size());
+  return os;
+}
+
 // foreground
 inline std::ostream &operator<<(std::ostream &os,
                                 const _color_code<true> &color_code) {
   const long mode = os.iword(_get_color_mode_index());
-  if (mode == _color_modes::COLOR_256)
-    os << "\033[38;5;" << color_code.code << 'm';
-  else if (mode == _color_modes::TRUE_COLOR)
-    os << "\033[38;2;" << color_code.r << ';' << color_code.g << ';'
-       << color_code.b << 'm';
-  return os;
+  const std::string_view sequence = color_code.sequence(mode);
+  _count_sequence(os, stream_stats::COLOR, mode, sequence.size());
+  return _write_sequence(os, sequence);
 }
 
 // background
 inline std::ostream &operator<<(std::ostream &os,
                                 const _color_code<false> &color_code) {
   const long mode = os.iword(_get_color_mode_index());
-  if (mode == _color_modes::COLOR_256)
-    os << "\033[48;5;" << color_code.code << 'm';
-  else if (mode == _color_modes::TRUE_COLOR)
-    os << "\033[48;2;" << color_code.r << ';' << color_code.g << ';'
-       << color_code.b << 'm';
-  return os;
+  const std::string_view sequence = color_code.sequence(mode);
+  _count_sequence(os, stream_stats::COLOR, mode, sequence.size());
+  return _write_sequence(os, sequence);
 }
 
 constexpr const _color_data _256colors[256] = {
@@ -340,7 +658,8 @@ constexpr float _color_distance(int r, int g, int b, _color_data color) {
           (blue_difference * blue_difference));
 }
 
-constexpr int _find_closest_color_code(int r, int g, int b) {
+// reference implementation, scans the whole table
+constexpr int _find_closest_color_code_exhaustive(int r, int g, int b) {
   // for dark colors we return black, the cutoff values are arbitrary but
   // prevent artifacting from redmean color distance approximation
   if (r < 20 && g < 15 && b < 15)
@@ -356,6 +675,266 @@ constexpr int _find_closest_color_code(int r, int g, int b) {
   return _256colors[best_index].code;
 }
 
+// Closest system colors (codes 0 - 15, and 0 - 7 for 8 color mode) by the
+// same redmean distance, ties go to the lower code. Terminals may redefine
+// these colors, stc::palette (stc_palette.hpp) matches against known values.
+constexpr void _find_closest_system_color_codes(int r, int g, int b,
+                                                int &code_16, int &code_8) {
+  float best_16 = _color_distance(r, g, b, _256colors[0]), best_8 = best_16;
+  code_16 = code_8 = 0;
+  for (int i = 1; i < 16; i++) {
+    const float distance = _color_distance(r, g, b, _256colors[i]);
+    if (distance < best_16)
+      best_16 = distance, code_16 = i;
+    if (i < 8 && distance < best_8)
+      best_8 = distance, code_8 = i;
+  }
+}
+
+// channel levels of the 6x6x6 color cube (codes 16 - 231)
+constexpr const int _cube_levels[6] = {0, 95, 135, 175, 215, 255};
+
+// Lookup tables that narrow the search down to a handful of candidates.
+// The nearest cube color always uses, per channel, one of the two levels
+// bracketing the channel value (any other level is worse by a margin far
+// larger than float rounding). Distance to the grey ramp (codes 232 - 255) is
+// convex, so the nearest grey is found by walking from a luma estimate.
+// Candidates are compared in table order with the same redmean distance, so
+// results are identical to _find_closest_color_code_exhaustive.
+class _quantization_index {
+public:
+  unsigned char cube_lower[256]{};
+  unsigned char grey_nearest[256]{};
+
+  constexpr _quantization_index() {
+    int level = 0;
+    for (int v = 0; v < 256; v++) {
+      while (level < 4 && _cube_levels[level + 1] <= v)
+        level++;
+      cube_lower[v] = (unsigned char)level;
+      const int grey = v < 8 ? 0 : (v - 3) / 10;
+      grey_nearest[v] = (unsigned char)(grey > 23 ? 23 : grey);
+    }
+  }
+
+  // r, g, b must be in range 0-255
+  constexpr int find(int r, int g, int b) const {
+    size_t best_index = 0;
+    float best_distance = 0;
+    auto consider = [&](size_t i) {
+      const float distance = _color_distance(r, g, b, _256colors[i]);
+      if (best_index == 0 || distance < best_distance) {
+        best_index = i;
+        best_distance = distance;
+      }
+    };
+
+    const int r_level = cube_lower[r], g_level = cube_lower[g],
+              b_level = cube_lower[b];
+    for (int i = r_level; i <= r_level + 1; i++)
+      for (int j = g_level; j <= g_level + 1; j++)
+        for (int k = b_level; k <= b_level + 1; k++)
+          consider((size_t)(16 + (36 * i) + (6 * j) + k));
+
+    auto grey_distance = [&](int k) {
+      return _color_distance(r, g, b, _256colors[232 + k]);
+    };
+    int grey = grey_nearest[(r + (2 * g) + b) / 4];
+    while (grey > 0 && grey_distance(grey - 1) < grey_distance(grey))
+      grey--;
+    while (grey < 23 && grey_distance(grey + 1) < grey_distance(grey))
+      grey++;
+    for (int k = grey > 0 ? grey - 1 : 0; k <= grey + 1 && k < 24; k++)
+      consider((size_t)(232 + k));
+
+    return _256colors[best_index].code;
+  }
+};
+
+inline constexpr _quantization_index _256color_index{};
+
+constexpr int _find_closest_color_code(int r, int g, int b) {
+  if (r < 20 && g < 15 && b < 15)
+    return _256colors[16].code;
+  if (r < 0 || r > 255 || g < 0 || g > 255 || b < 0 || b > 255)
+    return _find_closest_color_code_exhaustive(r, g, b);
+  return _256color_index.find(r, g, b);
+}
+
+// Perceptual matching: nearest palette color by euclidean distance in OKLab
+// (https://bottosson.github.io/posts/oklab/). Slower to compute than redmean
+// but picks better matches and needs no cutoff for dark colors.
+enum _color_matching { REDMEAN = 0, PERCEPTUAL = 1 };
+
+// n-th root by Newton's method, usable at compile time
+constexpr double _root(double a, int n) {
+  if (a <= 0)
+    return 0;
+  double y = a < 1 ? 0.2 + (0.8 * a) : a;
+  for (int i = 0; i < 100; i++) {
+    double power = 1;
+    for (int k = 0; k < n - 1; k++)
+      power *= y;
+    const double next = (((n - 1) * y) + (a / power)) / n;
+    // after the first step iterates decrease towards the root, until rounding
+    if (i > 0 && next >= y)
+      break;
+    y = next;
+  }
+  return y;
+}
+
+class _oklab {
+public:
+  float l = 0, a = 0, b = 0;
+};
+
+// cube root by Halley's method, converges in a few steps for inputs in 0-1
+constexpr double _cbrt(double a) {
+  if (a <= 0)
+    return 0;
+  double y = 0.2 + (0.8 * a);
+  for (int i = 0; i < 32; i++) {
+    const double cube = y * y * y;
+    const double next = y * (cube + (2 * a)) / ((2 * cube) + a);
+    const double change = next > y ? next - y : y - next;
+    y = next;
+    if (change <= 1e-12 * y)
+      break;
+  }
+  return y;
+}
+
+// sRGB channel values converted to linear light
+class _srgb_linear_table {
+public:
+  double values[256]{};
+  constexpr _srgb_linear_table() {
+    for (int i = 0; i < 256; i++) {
+      const double c = i / 255.0;
+      // ((c + 0.055) / 1.055) ^ 2.4, with x ^ 2.4 = x ^ 2 * (x ^ 2) ^ (1 / 5)
+      const double x = (c + 0.055) / 1.055;
+      values[i] = c <= 0.04045 ? c / 12.92 : x * x * _root(x * x, 5);
+    }
+  }
+};
+
+constexpr _oklab _rgb_to_oklab(const _srgb_linear_table &linear, int r, int g,
+                               int b) {
+  const double lr = linear.values[r], lg = linear.values[g],
+               lb = linear.values[b];
+  const double l = _cbrt((0.4122214708 * lr) + (0.5363325363 * lg) +
+                         (0.0514459929 * lb));
+  const double m = _cbrt((0.2119034982 * lr) + (0.6806995451 * lg) +
+                         (0.1073969566 * lb));
+  const double s = _cbrt((0.0883024619 * lr) + (0.2817188376 * lg) +
+                         (0.6299787005 * lb));
+  return {(float)((0.2104542553 * l) + (0.7936177850 * m) - (0.0040720468 * s)),
+          (float)((1.9779984951 * l) - (2.4285922050 * m) + (0.4505937099 * s)),
+          (float)((0.0259040371 * l) + (0.7827717662 * m) -
+                  (0.8086757660 * s))};
+}
+
+// Palette colors 16 - 255 in OKLab, stored as a balanced k-d tree: the node
+// of range [begin, end) is its middle element, split on l, a, b by depth.
+// A search visits the side of each split containing the query first and the
+// other side only if the split plane is closer than the best match so far.
+class _perceptual_index {
+public:
+  _srgb_linear_table linear{};
+  _oklab colors[240]{};
+  unsigned char codes[240]{};
+
+  constexpr _perceptual_index() {
+    for (int i = 0; i < 240; i++) {
+      const _color_data color = _256colors[i + 16];
+      colors[i] = _rgb_to_oklab(linear, color.r, color.g, color.b);
+      codes[i] = (unsigned char)color.code;
+    }
+    build(0, 240, 0);
+  }
+
+  // r, g, b must be in range 0-255, ties go to the lower code
+  constexpr int find(int r, int g, int b) const {
+    const _oklab query = _rgb_to_oklab(linear, r, g, b);
+    float best_distance = 1e30F;
+    int best_code = 256;
+
+    // pending ranges, with the squared distance to their split plane
+    int begins[32]{}, ends[32]{}, depths[32]{};
+    float plane_distances[32]{};
+    int size = 1;
+    ends[0] = 240;
+    while (size > 0) {
+      size--;
+      const int begin = begins[size], end = ends[size], depth = depths[size];
+      if (begin >= end || plane_distances[size] > best_distance)
+        continue;
+      const int middle = (begin + end) / 2;
+      const float dl = colors[middle].l - query.l,
+                  da = colors[middle].a - query.a,
+                  db = colors[middle].b - query.b;
+      const float distance = (dl * dl) + (da * da) + (db * db);
+      if (distance < best_distance ||
+          (distance == best_distance && codes[middle] < best_code)) {
+        best_distance = distance;
+        best_code = codes[middle];
+      }
+      const float offset =
+          _axis(query, depth % 3) - _axis(colors[middle], depth % 3);
+      const bool query_after = offset >= 0;
+      // far side first, so that the near side is popped next
+      begins[size] = query_after ? begin : middle + 1;
+      ends[size] = query_after ? middle : end;
+      depths[size] = depth + 1;
+      plane_distances[size++] = offset * offset;
+      begins[size] = query_after ? middle + 1 : begin;
+      ends[size] = query_after ? end : middle;
+      depths[size] = depth + 1;
+      plane_distances[size++] = 0;
+    }
+    return best_code;
+  }
+
+private:
+  static constexpr float _axis(const _oklab &color, int axis) {
+    return axis == 0 ? color.l : (axis == 1 ? color.a : color.b);
+  }
+
+  constexpr void build(int begin, int end, int depth) {
+    if (end - begin < 2)
+      return;
+    for (int i = begin + 1; i < end; i++) {
+      const _oklab color = colors[i];
+      const unsigned char code = codes[i];
+      int j = i;
+      for (; j > begin && _axis(colors[j - 1], depth % 3) >
+                              _axis(color, depth % 3);
+           j--) {
+        colors[j] = colors[j - 1];
+        codes[j] = codes[j - 1];
+      }
+      colors[j] = color;
+      codes[j] = code;
+    }
+    const int middle = (begin + end) / 2;
+    build(begin, middle, depth + 1);
+    build(middle + 1, end, depth + 1);
+  }
+};
+
+// a variable template with a dependent type, so that only translation units
+// using perceptual matching pay for building it at compile time
+template <class INDEX = _perceptual_index>
+inline constexpr INDEX _256color_perceptual_index{};
+
+template <_color_matching MATCHING>
+constexpr int _closest_color_code(int r, int g, int b) {
+  if constexpr (MATCHING == PERCEPTUAL)
+    return _256color_perceptual_index<>.find(r, g, b);
+  return _find_closest_color_code(r, g, b);
+}
+
 constexpr void _hsl_to_rgb(float h, float s, float l, int &r, int &g, int &b) {
   auto fmod = [](float number, int divisor) {
     const int i = (int)number;
@@ -383,6 +962,152 @@ constexpr void _hsl_to_rgb(float h, float s, float l, int &r, int &g, int &b) {
   b = round(f(4) * 255);
 }
 
+// Fixed-point conversions with 14 fractional bits. After the inputs are
+// converted everything is branch-free integer math, which is cheaper than
+// _hsl_to_rgb at runtime. Results are within 1 of the float conversion.
+constexpr int _fixed_one = 1 << 14;
+
+constexpr int _to_fixed_unit(float x) {
+  return (int)((std::min(std::max(x, 0.0F), 1.0F) * _fixed_one) + 0.5F);
+}
+
+// hue wraps around, so 1.25 is the same as 0.25
+constexpr int _to_fixed_hue(float h) {
+  // the fractional part of a negative hue is in (-1, 0], masking adds one
+  return (int)(((h - (float)(int)h) * _fixed_one) + 0.5F) & (_fixed_one - 1);
+}
+
+constexpr int _fixed_to_channel(int x) {
+  return ((x * 255) + (_fixed_one / 2)) >> 14;
+}
+
+// the conversions on fixed-point hue, saturation and lightness (or value),
+// integer math without branches
+constexpr void _fixed_hsl_to_rgb(int hue, int saturation, int lightness,
+                                 int &r, int &g, int &b) {
+  // same formula as _hsl_to_rgb: f(n) = l - a * max(-1, min(k - 3, 9 - k, 1))
+  const int a =
+      (saturation * std::min(lightness, _fixed_one - lightness)) >> 14;
+  auto f = [=](int n) {
+    int k = (n * _fixed_one) + (hue * 12);
+    k -= k >= 12 * _fixed_one ? 12 * _fixed_one : 0;
+    int t = std::min(k - (3 * _fixed_one), (9 * _fixed_one) - k);
+    t = std::max(-_fixed_one, std::min(t, _fixed_one));
+    // l - a * t, with a non-negative product
+    return lightness + a - ((a * (t + _fixed_one)) >> 14);
+  };
+  r = _fixed_to_channel(f(0));
+  g = _fixed_to_channel(f(8));
+  b = _fixed_to_channel(f(4));
+}
+
+constexpr void _fixed_hsv_to_rgb(int hue, int saturation, int value, int &r,
+                                 int &g, int &b) {
+  // (https://en.wikipedia.org/wiki/HSL_and_HSV#HSV_to_RGB_alternative)
+  // f(n) = v - v * s * max(0, min(k, 4 - k, 1))
+  const int chroma = (value * saturation) >> 14;
+  auto f = [=](int n) {
+    int k = (n * _fixed_one) + (hue * 6);
+    k -= k >= 6 * _fixed_one ? 6 * _fixed_one : 0;
+    int t = std::min(k, (4 * _fixed_one) - k);
+    t = std::max(0, std::min(t, _fixed_one));
+    return value - ((chroma * t) >> 14);
+  };
+  r = _fixed_to_channel(f(5));
+  g = _fixed_to_channel(f(3));
+  b = _fixed_to_channel(f(1));
+}
+
+// true while a constant expression is evaluated, always true where that can
+// not be told, so that the constexpr path is taken
+constexpr bool _is_constant_evaluated() {
+#if __cplusplus >= 202002L
+  return std::is_constant_evaluated();
+#elif defined(__GNUC__) || (defined(_MSC_VER) && _MSC_VER >= 1925)
+  return __builtin_is_constant_evaluated();
+#else
+  return true;
+#endif
+}
+
+constexpr void _hsl_to_rgb_fixed(float h, float s, float l, int &r, int &g,
+                                 int &b) {
+  _fixed_hsl_to_rgb(_to_fixed_hue(h), _to_fixed_unit(s), _to_fixed_unit(l), r,
+                    g, b);
+}
+
+constexpr void _hsv_to_rgb_fixed(float h, float s, float v, int &r, int &g,
+                                 int &b) {
+  _fixed_hsv_to_rgb(_to_fixed_hue(h), _to_fixed_unit(s), _to_fixed_unit(v), r,
+                    g, b);
+}
+
+// The conversions to fixed point of the batch functions. Float comparisons
+// may raise floating-point exceptions, so compilers do not turn them into
+// vector selects; these compare the bits of the floats as integers instead
+// (positive floats are ordered like their bits) and give the same results
+// as _to_fixed_unit and _to_fixed_hue.
+inline int32_t _float_bits(float x) {
+  int32_t bits = 0;
+  std::memcpy(&bits, &x, sizeof(bits));
+  return bits;
+}
+
+inline int _to_fixed_unit_bits(float x) {
+  int32_t bits = _float_bits(x);
+  bits = bits < 0 ? 0 : bits; // negative, including -0 and negative NaN
+  bits = bits > 0x3F800000 ? 0x3F800000 : bits; // above 1, or NaN
+  float clamped = 0;
+  std::memcpy(&clamped, &bits, sizeof(clamped));
+  return (int)((clamped * _fixed_one) + 0.5F);
+}
+
+inline int _to_fixed_hue_bits(float h) {
+  // from 2^23 on floats are whole numbers, which wrap to hue 0: larger
+  // magnitudes (and NaN) become 2^23, so that the cast to int is defined
+  int32_t bits = _float_bits(h);
+  const int32_t magnitude = bits & 0x7FFFFFFF;
+  bits = (bits ^ magnitude) | std::min(magnitude, (int32_t)0x4B000000);
+  float small = 0;
+  std::memcpy(&small, &bits, sizeof(small));
+  return (int)(((small - (float)(int)small) * _fixed_one) + 0.5F) &
+         (_fixed_one - 1);
+}
+
+// Converts n packed triples with CONVERT, a block at a time: the channels
+// are split into arrays first, so that the conversion loop reads and writes
+// consecutive elements, which compilers vectorize.
+template <void (*CONVERT)(int, int, int, int &, int &, int &)>
+inline void _fixed_to_rgb_blocks(const float *in, size_t n, uint8_t *rgb_out) {
+  constexpr size_t block = 64;
+  float x[block], y[block], z[block];
+  int r[block], g[block], b[block];
+  for (size_t start = 0; start < n; start += block) {
+    const size_t count = std::min(block, n - start);
+    for (size_t i = 0; i < count; i++, in += 3) {
+      x[i] = in[0];
+      y[i] = in[1];
+      z[i] = in[2];
+    }
+    for (size_t i = 0; i < count; i++)
+      CONVERT(_to_fixed_hue_bits(x[i]), _to_fixed_unit_bits(y[i]),
+              _to_fixed_unit_bits(z[i]), r[i], g[i], b[i]);
+    for (size_t i = 0; i < count; i++, rgb_out += 3) {
+      rgb_out[0] = (uint8_t)r[i];
+      rgb_out[1] = (uint8_t)g[i];
+      rgb_out[2] = (uint8_t)b[i];
+    }
+  }
+}
+
+// batch conversions of n packed triples to packed RGB bytes
+inline void hsl_to_rgb(const float *hsl, size_t n, uint8_t *rgb_out) {
+  _fixed_to_rgb_blocks<_fixed_hsl_to_rgb>(hsl, n, rgb_out);
+}
+inline void hsv_to_rgb(const float *hsv, size_t n, uint8_t *rgb_out) {
+  _fixed_to_rgb_blocks<_fixed_hsv_to_rgb>(hsv, n, rgb_out);
+}
+
 constexpr void _clamp(int &a, int min, int max) {
   if (a < min)
     a = min;
@@ -398,8 +1123,9 @@ constexpr void _clamp_rgb(int &r, int &g, int &b) {
 
 inline std::ostream &_print_if_color(std::ostream &os, std::string_view text) {
   const auto mode = os.iword(_get_color_mode_index());
+  _count_sequence(os, stream_stats::ATTRIBUTE, mode, text.size());
   if (mode != _color_modes::NO_COLOR)
-    return os << text;
+    return _write_sequence(os, text);
   return os;
 }
 
@@ -415,6 +1141,14 @@ inline std::ostream &no_color(std::ostream &os) {
   os.iword(_get_color_mode_index()) = _color_modes::NO_COLOR;
   return os;
 }
+inline std::ostream &color_16(std::ostream &os) {
+  os.iword(_get_color_mode_index()) = _color_modes::COLOR_16;
+  return os;
+}
+inline std::ostream &color_8(std::ostream &os) {
+  os.iword(_get_color_mode_index()) = _color_modes::COLOR_8;
+  return os;
+}
 
 inline std::ostream &reset(std::ostream &os) {
   return _print_if_color(os, "\033[0m");
@@ -444,40 +1178,679 @@ inline std::ostream &reset_bg(std::ostream &os) {
   return _print_if_color(os, "\033[49m");
 }
 
+template <_color_matching MATCHING = REDMEAN>
 constexpr _color_code<true> rgb_fg(int r, int g, int b) {
   _clamp_rgb(r, g, b);
-  return {r, g, b, _find_closest_color_code(r, g, b)};
+  return {r, g, b, _closest_color_code<MATCHING>(r, g, b)};
 }
 
+template <_color_matching MATCHING = REDMEAN>
 constexpr _color_code<false> rgb_bg(int r, int g, int b) {
   _clamp_rgb(r, g, b);
-  return {r, g, b, _find_closest_color_code(r, g, b)};
+  return {r, g, b, _closest_color_code<MATCHING>(r, g, b)};
 }
 
+template <_color_matching MATCHING = REDMEAN>
 constexpr _color_code<true> hsl_fg(float h, float s, float l) {
   int r = 0, g = 0, b = 0;
-  _hsl_to_rgb(h, s, l, r, g, b);
+  // constants keep the float results, at runtime the fixed-point conversion
+  // is cheaper
+  if (_is_constant_evaluated())
+    _hsl_to_rgb(h, s, l, r, g, b);
+  else
+    _hsl_to_rgb_fixed(h, s, l, r, g, b);
   _clamp_rgb(r, g, b);
-  return {r, g, b, _find_closest_color_code(r, g, b)};
+  return {r, g, b, _closest_color_code<MATCHING>(r, g, b)};
 }
 
+template <_color_matching MATCHING = REDMEAN>
 constexpr _color_code<false> hsl_bg(float h, float s, float l) {
   int r = 0, g = 0, b = 0;
-  _hsl_to_rgb(h, s, l, r, g, b);
+  // constants keep the float results, at runtime the fixed-point conversion
+  // is cheaper
+  if (_is_constant_evaluated())
+    _hsl_to_rgb(h, s, l, r, g, b);
+  else
+    _hsl_to_rgb_fixed(h, s, l, r, g, b);
   _clamp_rgb(r, g, b);
-  return {r, g, b, _find_closest_color_code(r, g, b)};
+  return {r, g, b, _closest_color_code<MATCHING>(r, g, b)};
+}
+
+template <_color_matching MATCHING = REDMEAN>
+constexpr _color_code<true> hsv_fg(float h, float s, float v) {
+  int r = 0, g = 0, b = 0;
+  _hsv_to_rgb_fixed(h, s, v, r, g, b);
+  return {r, g, b, _closest_color_code<MATCHING>(r, g, b)};
+}
+
+template <_color_matching MATCHING = REDMEAN>
+constexpr _color_code<false> hsv_bg(float h, float s, float v) {
+  int r = 0, g = 0, b = 0;
+  _hsv_to_rgb_fixed(h, s, v, r, g, b);
+  return {r, g, b, _closest_color_code<MATCHING>(r, g, b)};
 }
 
 constexpr _color_code<true> code_fg(int code) {
   _clamp(code, 0, 255);
   const auto color_data = _256colors[code];
-  return {color_data.r, color_data.g, color_data.b, color_data.code};
+  return {(int)color_data.r, (int)color_data.g, (int)color_data.b,
+          (int)color_data.code};
 }
 
 constexpr _color_code<false> code_bg(int code) {
   _clamp(code, 0, 255);
   const auto color_data = _256colors[code];
-  return {color_data.r, color_data.g, color_data.b, color_data.code};
+  return {(int)color_data.r, (int)color_data.g, (int)color_data.b,
+          (int)color_data.code};
+}
+
+using _manipulator = std::ostream &(*)(std::ostream &);
+
+// SGR parameter written by an attribute manipulator, -1 for other functions.
+// Comparing function pointers is not a constant expression with some
+// compilers (e.g. GCC with UBSan), the parameter is found by specialization
+// at compile time and by comparison at runtime.
+template <_manipulator MANIPULATOR> struct _attribute_parameter {
+  static constexpr int value = -1;
+};
+template <> struct _attribute_parameter<reset> {
+  static constexpr int value = 0;
+};
+template <> struct _attribute_parameter<bold> {
+  static constexpr int value = 1;
+};
+template <> struct _attribute_parameter<faint> {
+  static constexpr int value = 2;
+};
+template <> struct _attribute_parameter<italic> {
+  static constexpr int value = 3;
+};
+template <> struct _attribute_parameter<underline> {
+  static constexpr int value = 4;
+};
+template <> struct _attribute_parameter<inverse> {
+  static constexpr int value = 7;
+};
+template <> struct _attribute_parameter<crossed_out> {
+  static constexpr int value = 9;
+};
+template <> struct _attribute_parameter<reset_fg> {
+  static constexpr int value = 39;
+};
+template <> struct _attribute_parameter<reset_bg> {
+  static constexpr int value = 49;
+};
+
+inline int _manipulator_parameter(_manipulator manipulator) {
+  if (manipulator == reset)
+    return 0;
+  if (manipulator == bold)
+    return 1;
+  if (manipulator == faint)
+    return 2;
+  if (manipulator == italic)
+    return 3;
+  if (manipulator == underline)
+    return 4;
+  if (manipulator == inverse)
+    return 7;
+  if (manipulator == crossed_out)
+    return 9;
+  if (manipulator == reset_fg)
+    return 39;
+  if (manipulator == reset_bg)
+    return 49;
+  return -1;
+}
+
+// Colors and attributes combined into a single escape sequence:
+//   constexpr stc::style warning = stc::rgb_fg(95, 21, 191) |
+//                                  stc::code_bg(17) |
+//                                  stc::attribute<stc::bold>;
+//   cout << warning; // "\033[1;38;5;55;48;5;17m"
+// Parts on the right override colors on the left, stc::reset drops
+// everything on its left. Manipulators that are not attributes are ignored.
+// Outside constant expressions attributes can be given as they are, e.g.
+// stc::style(stc::bold) | stc::underline.
+class style {
+public:
+  constexpr style() = default;
+  constexpr style(const _color_code<true> &fg) : fg(fg), fg_kind(COLOR) {
+    render();
+  }
+  constexpr style(const _color_code<false> &bg) : bg(bg), bg_kind(COLOR) {
+    render();
+  }
+  style(_manipulator manipulator) {
+    set_parameter(_manipulator_parameter(manipulator));
+  }
+  // the attribute with the given SGR parameter, see stc::attribute
+  static constexpr style _from_parameter(int parameter) {
+    style result;
+    result.set_parameter(parameter);
+    return result;
+  }
+
+  friend constexpr style operator|(const style &left, const style &right);
+
+  // the colors the style sets, fg_color and bg_color are only meaningful
+  // when has_fg and has_bg are true
+  constexpr bool has_fg() const { return fg_kind == COLOR; }
+  constexpr bool has_bg() const { return bg_kind == COLOR; }
+  constexpr const _color_code<true> &fg_color() const { return fg; }
+  constexpr const _color_code<false> &bg_color() const { return bg; }
+  // the attributes the style sets, bit n for SGR parameter n
+  constexpr unsigned short attribute_bits() const { return attributes; }
+
+  // escape sequence emitted in the given color mode
+  constexpr std::string_view sequence(long mode) const {
+    if (mode < 0 || mode >= _color_mode_count)
+      return {};
+    return sequences[mode].view();
+  }
+
+private:
+  enum color_kind : unsigned char { NONE, DEFAULT, COLOR };
+
+  _color_code<true> fg{0, 0, 0, 0};
+  _color_code<false> bg{0, 0, 0, 0};
+  color_kind fg_kind = NONE, bg_kind = NONE;
+  bool is_reset = false;
+  unsigned short attributes = 0; // bit n is set for SGR parameter n
+  // indexed by _color_modes, the longest is
+  // "\033[0;1;2;3;4;7;9;38;2;255;255;255;48;2;255;255;255m"
+  _basic_sequence<52> sequences[_color_mode_count];
+
+  template <bool IS_FOREGROUND>
+  static constexpr void render_color(_basic_sequence<52> &sequence,
+                                     const _color_code<IS_FOREGROUND> &color,
+                                     color_kind kind, long mode) {
+    if (kind == NONE)
+      return;
+    if (sequence.size > 2)
+      sequence.append(';');
+    const bool is_foreground = IS_FOREGROUND;
+    if (kind == DEFAULT) {
+      sequence.append(is_foreground ? "39" : "49");
+    } else if (mode == _color_modes::COLOR_16 ||
+               mode == _color_modes::COLOR_8) {
+      // "\033[91m" without the escape and the final byte
+      const std::string_view color_sequence = color.sequence(mode);
+      sequence.append(color_sequence.substr(2, color_sequence.size() - 3));
+    } else if (mode == _color_modes::TRUE_COLOR) {
+      sequence.append(is_foreground ? "38;2;" : "48;2;");
+      sequence.append_number((int)color.r);
+      sequence.append(';');
+      sequence.append_number((int)color.g);
+      sequence.append(';');
+      sequence.append_number((int)color.b);
+    } else {
+      sequence.append(is_foreground ? "38;5;" : "48;5;");
+      sequence.append_number((int)color.code);
+    }
+  }
+
+  constexpr void set_parameter(int parameter) {
+    if (parameter == 0)
+      is_reset = true;
+    else if (parameter == 39)
+      fg_kind = DEFAULT;
+    else if (parameter == 49)
+      bg_kind = DEFAULT;
+    else if (parameter > 0)
+      attributes = (unsigned short)(1U << parameter);
+    render();
+  }
+
+  constexpr void render() {
+    for (long mode = 0; mode < _color_mode_count; mode++) {
+      _basic_sequence<52> &sequence = sequences[mode];
+      sequence = {};
+      if (mode == _color_modes::NO_COLOR)
+        continue;
+      sequence.append("\033[");
+      if (is_reset)
+        sequence.append('0');
+      for (int p = 1; p <= 9; p++) {
+        if ((attributes & (1U << p)) == 0)
+          continue;
+        if (sequence.size > 2)
+          sequence.append(';');
+        sequence.append_number(p);
+      }
+      render_color(sequence, fg, fg_kind, mode);
+      render_color(sequence, bg, bg_kind, mode);
+      if (sequence.size == 2)
+        sequence = {};
+      else
+        sequence.append('m');
+    }
+  }
+};
+
+constexpr style operator|(const style &left, const style &right) {
+  style result = right.is_reset ? style{} : left;
+  result.is_reset = left.is_reset || right.is_reset;
+  result.attributes |= right.attributes;
+  if (right.fg_kind != style::NONE) {
+    result.fg = right.fg;
+    result.fg_kind = right.fg_kind;
+  }
+  if (right.bg_kind != style::NONE) {
+    result.bg = right.bg;
+    result.bg_kind = right.bg_kind;
+  }
+  result.render();
+  return result;
+}
+
+// An attribute manipulator as a style, usable in constant expressions:
+//   constexpr stc::style title =
+//       stc::attribute<stc::bold> | stc::attribute<stc::underline>;
+template <_manipulator MANIPULATOR> constexpr style _attribute_style() {
+  static_assert(_attribute_parameter<MANIPULATOR>::value >= 0,
+                "stc::attribute takes an attribute manipulator");
+  return style::_from_parameter(_attribute_parameter<MANIPULATOR>::value);
+}
+template <_manipulator MANIPULATOR>
+inline constexpr style attribute = _attribute_style<MANIPULATOR>();
+
+inline std::ostream &operator<<(std::ostream &os, const style &s) {
+  const long mode = os.iword(_get_color_mode_index());
+  const std::string_view sequence = s.sequence(mode);
+  _count_sequence(os, stream_stats::STYLE, mode, sequence.size());
+  return _write_sequence(os, sequence);
+}
+
+// Output without iostreams: the functions below write the same bytes as the
+// stream operators to a caller owned buffer, for the given color mode.
+
+// no sequence written by this library is longer than this
+constexpr size_t max_sequence_size = 52;
+
+// escape sequence written by an attribute manipulator in the given mode
+inline _basic_sequence<5> _manipulator_sequence(_manipulator manipulator,
+                                                long mode) {
+  _basic_sequence<5> sequence;
+  const int parameter = _manipulator_parameter(manipulator);
+  if (parameter < 0 || mode == _color_modes::NO_COLOR)
+    return sequence;
+  sequence.append("\033[");
+  sequence.append_number(parameter);
+  sequence.append('m');
+  return sequence;
+}
+
+// the buffer must have room for max_sequence_size bytes, out is advanced past
+// the written bytes
+inline void append(char *&out, std::string_view text) {
+  std::char_traits<char>::copy(out, text.data(), text.size());
+  out += text.size();
+}
+template <bool IS_FOREGROUND>
+inline void append(char *&out, const _color_code<IS_FOREGROUND> &color_code,
+                   _color_modes mode) {
+  append(out, color_code.sequence(mode));
 }
+inline void append(char *&out, const style &s, _color_modes mode) {
+  append(out, s.sequence(mode));
+}
+inline void append(char *&out, _manipulator manipulator, _color_modes mode) {
+  append(out, _manipulator_sequence(manipulator, mode).view());
+}
+
+inline void append(std::string &out, std::string_view text) {
+  out.append(text);
+}
+template <bool IS_FOREGROUND>
+inline void append(std::string &out,
+                   const _color_code<IS_FOREGROUND> &color_code,
+                   _color_modes mode) {
+  out.append(color_code.sequence(mode));
+}
+inline void append(std::string &out, const style &s, _color_modes mode) {
+  out.append(s.sequence(mode));
+}
+inline void append(std::string &out, _manipulator manipulator,
+                   _color_modes mode) {
+  out.append(_manipulator_sequence(manipulator, mode).view());
+}
+
+#if __cplusplus >= 202002L
+// writes at the front of out and shrinks it, returns false and writes nothing
+// if the bytes do not fit
+inline bool append(std::span<char> &out, std::string_view text) {
+  if (text.size() > out.size())
+    return false;
+  std::char_traits<char>::copy(out.data(), text.data(), text.size());
+  out = out.subspan(text.size());
+  return true;
+}
+template <bool IS_FOREGROUND>
+inline bool append(std::span<char> &out,
+                   const _color_code<IS_FOREGROUND> &color_code,
+                   _color_modes mode) {
+  return append(out, color_code.sequence(mode));
+}
+inline bool append(std::span<char> &out, const style &s, _color_modes mode) {
+  return append(out, s.sequence(mode));
+}
+inline bool append(std::span<char> &out, _manipulator manipulator,
+                   _color_modes mode) {
+  return append(out, _manipulator_sequence(manipulator, mode).view());
+}
+#endif
+
+// Text with style tags, expanded at compile time into the bytes written in
+// each color mode:
+//   constexpr auto prefix = stc::markup("[bold][fg:#5f15bf]Error:[reset] ");
+//   cout << prefix; // a single write of "\033[1;38;5;55mError:\033[0m "
+// Tags: [reset] [bold] [faint] [italic] [underline] [inverse] [crossed_out]
+// [reset_fg] [reset_bg] and [fg:COLOR] [bg:COLOR], where COLOR is #rrggbb,
+// rgb(r,g,b), hsl(h,s,l) or a 256 color code. Adjacent tags are merged into
+// one sequence, "[[" writes a '['. Malformed markup fails to compile.
+template <size_t CAPACITY> class _markup {
+public:
+  char data[_color_mode_count][CAPACITY]{}; // indexed by _color_modes
+  size_t size[_color_mode_count]{};
+
+  constexpr std::string_view sequence(long mode) const {
+    if (mode < 0 || mode >= _color_mode_count)
+      return {};
+    return {data[mode], size[mode]};
+  }
+
+  constexpr void append(long mode, std::string_view text) {
+    if (size[mode] + text.size() > CAPACITY)
+      throw std::length_error("stc::markup: expansion too long");
+    for (const char c : text)
+      data[mode][size[mode]++] = c;
+  }
+};
+
+class _markup_parser {
+public:
+  std::string_view text;
+  size_t position = 0;
+
+  constexpr bool consume(std::string_view prefix) {
+    if (text.substr(position, prefix.size()) != prefix)
+      return false;
+    position += prefix.size();
+    return true;
+  }
+  constexpr void expect(char c) {
+    if (!consume(std::string_view(&c, 1)))
+      throw std::invalid_argument("stc::markup: malformed tag");
+  }
+  constexpr bool at_digit() const {
+    return position < text.size() && text[position] >= '0' &&
+           text[position] <= '9';
+  }
+  constexpr int parse_int() {
+    if (!at_digit())
+      throw std::invalid_argument("stc::markup: expected a number");
+    int number = 0;
+    while (at_digit() && number < 100000)
+      number = (number * 10) + (text[position++] - '0');
+    return number;
+  }
+  constexpr float parse_float() {
+    double number = parse_int();
+    if (consume(".")) {
+      double scale = 1;
+      while (at_digit()) {
+        scale /= 10;
+        number += (text[position++] - '0') * scale;
+      }
+    }
+    return (float)number;
+  }
+  constexpr int parse_hex_digit() {
+    const char c = position < text.size() ? text[position++] : '\0';
+    if (c >= '0' && c <= '9')
+      return c - '0';
+    if (c >= 'a' && c <= 'f')
+      return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+      return c - 'A' + 10;
+    throw std::invalid_argument("stc::markup: malformed hex color");
+  }
+
+  template <bool IS_FOREGROUND>
+  constexpr _color_code<IS_FOREGROUND> parse_color() {
+    int r = 0, g = 0, b = 0;
+    if (consume("#")) {
+      int channels[3]{};
+      for (int &channel : channels) {
+        channel = parse_hex_digit() * 16;
+        channel += parse_hex_digit();
+      }
+      r = channels[0], g = channels[1], b = channels[2];
+    } else if (consume("rgb(")) {
+      r = parse_int();
+      expect(',');
+      g = parse_int();
+      expect(',');
+      b = parse_int();
+      expect(')');
+    } else if (consume("hsl(")) {
+      const float h = parse_float();
+      expect(',');
+      const float s = parse_float();
+      expect(',');
+      const float l = parse_float();
+      expect(')');
+      _hsl_to_rgb(h, s, l, r, g, b);
+    } else {
+      int code = parse_int();
+      _clamp(code, 0, 255);
+      const auto color_data = _256colors[code];
+      return {(int)color_data.r, (int)color_data.g, (int)color_data.b,
+              (int)color_data.code};
+    }
+    _clamp_rgb(r, g, b);
+    return {r, g, b, _find_closest_color_code(r, g, b)};
+  }
+
+  // parses the inside of a tag, after '['
+  constexpr style parse_tag() {
+    constexpr int parameters[] = {0, 1, 2, 3, 4, 7, 9, 39, 49};
+    constexpr std::string_view names[] = {
+        "reset]",   "bold]",        "faint]",    "italic]",  "underline]",
+        "inverse]", "crossed_out]", "reset_fg]", "reset_bg]"};
+    for (size_t i = 0; i < std::size(names); i++)
+      if (consume(names[i]))
+        return style::_from_parameter(parameters[i]);
+    style color;
+    if (consume("fg:"))
+      color = parse_color<true>();
+    else if (consume("bg:"))
+      color = parse_color<false>();
+    else
+      throw std::invalid_argument("stc::markup: unknown tag");
+    expect(']');
+    return color;
+  }
+};
+
+template <size_t N> constexpr auto markup(const char (&text)[N]) {
+  // a tag expands to at most 3.2 times its length ("[fg:7]" in true color)
+  _markup<(4 * N) + max_sequence_size> result;
+  _markup_parser parser{std::string_view(text, N - 1)};
+  style pending;
+  bool has_pending = false;
+  auto flush = [&]() {
+    if (!has_pending)
+      return;
+    for (long mode = 0; mode < _color_mode_count; mode++)
+      result.append(mode, pending.sequence(mode));
+    pending = {};
+    has_pending = false;
+  };
+  while (parser.position < parser.text.size()) {
+    if (parser.consume("[[")) {
+      flush();
+      for (long mode = 0; mode < _color_mode_count; mode++)
+        result.append(mode, "[");
+    } else if (parser.consume("[")) {
+      pending = pending | parser.parse_tag();
+      has_pending = true;
+    } else {
+      flush();
+      const char c = parser.text[parser.position++];
+      for (long mode = 0; mode < _color_mode_count; mode++)
+        result.append(mode, std::string_view(&c, 1));
+    }
+  }
+  flush();
+  return result;
+}
+
+#if __cplusplus >= 202002L
+template <size_t N> class _fixed_string {
+public:
+  char data[N]{};
+  constexpr _fixed_string(const char (&text)[N]) {
+    std::copy(text, text + N, data);
+  }
+};
+
+template <_fixed_string TEXT>
+inline constexpr auto _markup_constant = markup(TEXT.data);
+
+// C++20: stc::markup<"[bold]Error:[reset] ">()
+template <_fixed_string TEXT> constexpr const auto &markup() {
+  return _markup_constant<TEXT>;
+}
+#endif
+
+template <size_t CAPACITY>
+inline std::ostream &operator<<(std::ostream &os,
+                                const _markup<CAPACITY> &markup_text) {
+  const long mode = os.iword(_get_color_mode_index());
+  if constexpr (stats_enabled) {
+    // the sequences are what the text gains over its NO_COLOR version
+    const size_t text_size = markup_text.sequence(NO_COLOR).size();
+    if (markup_text.sequence(COLOR_256).size() != text_size)
+      _count_sequence(os, stream_stats::MARKUP, mode,
+                      markup_text.sequence(mode).size() - text_size);
+  }
+  return _write_sequence(os, markup_text.sequence(mode));
+}
+
+template <size_t CAPACITY>
+inline void append(char *&out, const _markup<CAPACITY> &markup_text,
+                   _color_modes mode) {
+  append(out, markup_text.sequence(mode));
+}
+template <size_t CAPACITY>
+inline void append(std::string &out, const _markup<CAPACITY> &markup_text,
+                   _color_modes mode) {
+  out.append(markup_text.sequence(mode));
+}
+#if __cplusplus >= 202002L
+template <size_t CAPACITY>
+inline bool append(std::span<char> &out, const _markup<CAPACITY> &markup_text,
+                   _color_modes mode) {
+  return append(out, markup_text.sequence(mode));
+}
+#endif
+
+template <size_t N>
+constexpr std::array<char, N> _to_array(std::string_view text) {
+  std::array<char, N> result{};
+  for (size_t i = 0; i < N; i++)
+    result[i] = text[i];
+  return result;
+}
+
+// The escape sequence of a constexpr color, style or markup in the given
+// color mode, as an array of exactly its bytes (no terminating '\0'):
+//   static constexpr auto purple = stc::rgb_fg(95, 21, 191);
+//   constexpr auto &bytes = stc::escape_literal<stc::TRUE_COLOR, purple>;
+template <_color_modes MODE, const auto &ITEM>
+inline constexpr auto escape_literal =
+    _to_array<ITEM.sequence(MODE).size()>(ITEM.sequence(MODE));
+
+// A stream with a color mode fixed at compile time, for programs that always
+// write in one mode (e.g. a true color TUI):
+//   stc::styled_ostream<stc::TRUE_COLOR> out(std::cout);
+//   out << stc::rgb_fg(95, 21, 191) << "purple" << stc::reset << '\n';
+// Colors, styles, markup and attribute manipulators are rendered for MODE
+// without reading the color mode of the stream, in NO_COLOR mode their
+// sequences are not written at all. Everything else is passed to the wrapped
+// stream, whose color mode is set to MODE so that both agree.
+template <_color_modes MODE> class styled_ostream {
+public:
+  static constexpr _color_modes mode = MODE;
+
+  explicit styled_ostream(std::ostream &os) : os(os) {
+    os.iword(_get_color_mode_index()) = MODE;
+  }
+
+  std::ostream &stream() const { return os; }
+
+  template <bool IS_FOREGROUND>
+  styled_ostream &operator<<(const _color_code<IS_FOREGROUND> &color_code) {
+    return write_sequence(stream_stats::COLOR, color_code.sequence(MODE));
+  }
+  styled_ostream &operator<<(const style &s) {
+    return write_sequence(stream_stats::STYLE, s.sequence(MODE));
+  }
+  styled_ostream &operator<<(_manipulator manipulator) {
+    const int parameter = _manipulator_parameter(manipulator);
+    if (parameter < 0) {
+      manipulator(os); // std::endl, std::flush, ...
+      return *this;
+    }
+    return write_sequence(stream_stats::ATTRIBUTE,
+                          attribute_sequences[parameter].view());
+  }
+  template <size_t CAPACITY>
+  styled_ostream &operator<<(const _markup<CAPACITY> &markup_text) {
+    _write_sequence(os, markup_text.sequence(MODE));
+    return *this;
+  }
+  // bytes of an escape_literal
+  template <size_t N>
+  styled_ostream &operator<<(const std::array<char, N> &sequence) {
+    if constexpr (N != 0)
+      os.write(sequence.data(), (std::streamsize)N);
+    return *this;
+  }
+  template <class T> styled_ostream &operator<<(const T &value) {
+    os << value;
+    return *this;
+  }
+
+private:
+  // sequences of the attribute manipulators, by SGR parameter
+  struct attribute_table {
+    _basic_sequence<5> sequences[50];
+    constexpr attribute_table() {
+      for (int parameter : {0, 1, 2, 3, 4, 7, 9, 39, 49})
+        if (MODE != _color_modes::NO_COLOR) {
+          sequences[parameter].append("\033[");
+          sequences[parameter].append_number(parameter);
+          sequences[parameter].append('m');
+        }
+    }
+    constexpr const _basic_sequence<5> &operator[](int parameter) const {
+      return sequences[parameter];
+    }
+  };
+  static constexpr attribute_table attribute_sequences{};
+
+  std::ostream &os;
+
+  styled_ostream &write_sequence(stream_stats::sequence_type type,
+                                 std::string_view sequence) {
+    _count_sequence(os, type, MODE, sequence.size());
+    if constexpr (MODE != _color_modes::NO_COLOR)
+      _write_sequence(os, sequence);
+    return *this;
+  }
+};
 
 } // namespace stc
@@ -0,0 +1,366 @@
+/*
+MIT License
+
+Copyright (c) 2024 illyigan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "stc.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <thread>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <cerrno>
+#include <poll.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace stc {
+
+// A streambuf that writes to a file descriptor from a background thread, so
+// that a slow terminal (or SSH session) does not block the writing thread:
+//   stc::async_writer writer(std::cout, 1);
+//   std::cout << stc::rgb_fg(95, 21, 191) << "frame " << i << stc::reset
+//             << '\n'; // returns once the line is copied
+// Text, escape sequences included, is written straight into a ring buffer
+// and published a whole line at a time (or on flush). The writer thread
+// writes everything published with one writev call, which covers the wrap
+// around the end of the ring. When the ring is full the policy decides:
+// - BLOCK waits for the writer to make room
+// - DROP drops the line being written, so unless it was flushed halfway a
+//   line is written whole or not at all, escape sequences included
+// - COALESCE drops the published lines the writer has not started on, in
+//   favor of the newest output, for progress displays that redraw
+// drain() and the destructor return once everything published is written.
+// Like any streambuf it is written by one thread at a time, a stc::log_sink
+// on a stream using it lets many threads write.
+class async_writer : public std::streambuf {
+public:
+  enum backpressure { BLOCK, DROP, COALESCE };
+
+  explicit async_writer(int fd, size_t capacity = 1 << 16,
+                        backpressure policy = BLOCK)
+      : fd(fd), capacity(_ring_capacity(capacity)), mask(this->capacity - 1),
+        ring(new char[this->capacity]), policy(policy),
+        writer([this]() { write_published(); }) {
+    reset_put_area();
+  }
+  // writes the output of os, which is flushed first, until destroyed
+  async_writer(std::ostream &os, int fd, size_t capacity = 1 << 16,
+               backpressure policy = BLOCK)
+      : async_writer(fd, capacity, policy) {
+    os.flush();
+    installed_on = &os;
+    previous = os.rdbuf(this);
+  }
+  async_writer(const async_writer &) = delete;
+  async_writer &operator=(const async_writer &) = delete;
+  ~async_writer() override {
+    async_writer::drain();
+    {
+      const std::lock_guard<std::mutex> lock(mutex);
+      stopping.store(true);
+      data_ready.notify_one();
+    }
+    writer.join();
+    if (installed_on != nullptr)
+      installed_on->rdbuf(previous);
+  }
+
+  // publishes everything written so far and waits until it is written
+  void drain() {
+    async_writer::sync();
+    const size_t target = committed;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      producer_waiting.store(true);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (tail.load(std::memory_order_acquire) >= target)
+        break;
+      space_ready.wait_for(lock, std::chrono::milliseconds(10));
+    }
+    producer_waiting.store(false);
+  }
+
+  // bytes dropped by the DROP and COALESCE policies or lost to write errors
+  size_t discarded() const { return discarded_bytes.load(); }
+  // true after a write failed, the output after that is discarded
+  bool failed() const { return write_failed.load(); }
+
+protected:
+  int_type overflow(int_type c) override {
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+      const char ch = traits_type::to_char_type(c);
+      xsputn(&ch, 1);
+    }
+    return traits_type::not_eof(c);
+  }
+
+  std::streamsize xsputn(const char *data, std::streamsize size) override {
+    // put() and std::endl write into the put area without a call while it
+    // has room, find the lines they ended
+    find_line_head();
+    const char *const end = data + size;
+    while (data != end) {
+      if (dropping) {
+        const char *newline =
+            std::char_traits<char>::find(data, (size_t)(end - data), '\n');
+        const char *const kept = newline != nullptr ? newline + 1 : end;
+        discarded_bytes.fetch_add((size_t)(kept - data));
+        data = kept;
+        if (newline != nullptr) {
+          dropping = false;
+          reset_put_area();
+        }
+        continue;
+      }
+      if (pptr() == epptr()) {
+        make_room();
+        continue;
+      }
+      const size_t count = std::min((size_t)(epptr() - pptr()),
+                                    (size_t)(end - data));
+      std::char_traits<char>::copy(pptr(), data, count);
+      pbump((int)count);
+      find_line_head();
+      data += count;
+    }
+    if (line_head > committed)
+      commit(line_head);
+    return size;
+  }
+
+  // publishes a partial line as well, without waiting for it to be written
+  int sync() override {
+    if (!dropping) {
+      line_head = scanned = produced();
+      if (line_head > committed)
+        commit(line_head);
+    }
+    return write_failed.load() ? -1 : 0;
+  }
+
+private:
+  const int fd;
+  const size_t capacity, mask;
+  const std::unique_ptr<char[]> ring;
+  const backpressure policy;
+  std::ostream *installed_on = nullptr;
+  std::streambuf *previous = nullptr;
+
+  // Positions count the bytes written since the start, the byte at position
+  // p is at ring[p & mask]. The writer has written up to tail, the bytes up
+  // to head are published, the ones up to the put pointer are not yet.
+  std::atomic<size_t> head{0}, tail{0};
+  // COALESCE asks the writer to skip the published bytes up to it
+  std::atomic<size_t> skip_to{0};
+  // producer only: position of pbase(), head, the end of the last line and
+  // how far the put area was searched for it
+  size_t put_start = 0, committed = 0, line_head = 0, scanned = 0;
+  // producer only, DROP discards the rest of a line that did not fit
+  bool dropping = false;
+
+  std::atomic<size_t> discarded_bytes{0};
+  std::atomic<bool> write_failed{false}, stopping{false};
+  std::mutex mutex; // only taken to sleep and to wake the other thread
+  std::condition_variable data_ready, space_ready;
+  std::atomic<bool> writer_waiting{false}, producer_waiting{false};
+  std::thread writer;
+
+  static size_t _ring_capacity(size_t capacity) {
+    size_t size = 256;
+    while (size < capacity && size < ((size_t)1 << 30))
+      size <<= 1;
+    return size;
+  }
+
+  size_t produced() const { return put_start + (size_t)(pptr() - pbase()); }
+
+  // moves line_head past the last newline written to the put area
+  void find_line_head() {
+    const size_t position = produced();
+    if (position == scanned)
+      return;
+    const std::string_view written(pbase() + (scanned - put_start),
+                                   position - scanned);
+    const size_t newline = written.rfind('\n');
+    if (newline != std::string_view::npos)
+      line_head = scanned + newline + 1;
+    scanned = position;
+  }
+
+  // the free space after the put pointer, up to the end of the ring memory,
+  // with the writer at position written
+  void reset_put_area(size_t written) {
+    const size_t position = produced();
+    const size_t ring_end = (position | mask) + 1;
+    char *const start = ring.get() + (position & mask);
+    setp(start, start + (std::min(written + capacity, ring_end) - position));
+    put_start = scanned = position;
+  }
+  void reset_put_area() {
+    reset_put_area(tail.load(std::memory_order_acquire));
+  }
+
+  void commit(size_t end) {
+    head.store(end, std::memory_order_release);
+    committed = end;
+    // pairs with the fence in write_published
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (writer_waiting.load() && writer_waiting.exchange(false)) {
+      const std::lock_guard<std::mutex> lock(mutex);
+      data_ready.notify_one();
+    }
+  }
+
+  // called with a full put area, returns with space or with dropping set
+  void make_room() {
+    if (line_head > committed)
+      commit(line_head);
+    // the put area stops at the end of the ring memory, and the writer may
+    // have made room since it was set; all that follows is decided on this
+    // one reading of its position
+    const size_t written = tail.load(std::memory_order_acquire);
+    reset_put_area(written);
+    if (pptr() != epptr())
+      return;
+    const size_t position = produced();
+    if (policy == DROP) {
+      discarded_bytes.fetch_add(position - line_head);
+      setp(nullptr, nullptr);
+      put_start = scanned = line_head;
+      dropping = true;
+      return;
+    }
+    if (position - line_head >= capacity) {
+      // a line that fills the ring on its own is written in parts
+      commit(position);
+    } else if (policy == COALESCE) {
+      // the ring holds published lines the writer has not written yet
+      skip_to.store(committed, std::memory_order_release);
+      commit(committed); // wakes the writer
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      producer_waiting.store(true);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      reset_put_area();
+      if (pptr() != epptr())
+        break;
+      space_ready.wait_for(lock, std::chrono::milliseconds(10));
+    }
+    producer_waiting.store(false);
+  }
+
+  // writes ring bytes from position from to position to, the output is
+  // discarded after a write failed
+  void write_range(size_t from, const size_t to) {
+    while (from != to && !write_failed.load()) {
+      const size_t start = from & mask;
+      const size_t first = std::min(to - from, capacity - start);
+#ifdef _WIN32
+      const int written = _write(fd, ring.get() + start, (unsigned)first);
+      if (written < 0) {
+        write_failed.store(true);
+        break;
+      }
+#else
+      iovec parts[2] = {{ring.get() + start, first},
+                        {ring.get(), to - from - first}};
+      const ssize_t written = ::writev(fd, parts, parts[1].iov_len ? 2 : 1);
+      if (written < 0) {
+        if (errno == EINTR)
+          continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          pollfd ready{fd, POLLOUT, 0};
+          ::poll(&ready, 1, -1);
+          continue;
+        }
+        write_failed.store(true);
+        break;
+      }
+#endif
+      from += (size_t)written;
+    }
+    if (from != to)
+      discarded_bytes.fetch_add(to - from);
+  }
+
+  void publish_tail(size_t position) {
+    tail.store(position, std::memory_order_release);
+    // pairs with the fences in make_room and drain
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (producer_waiting.load() && producer_waiting.exchange(false)) {
+      const std::lock_guard<std::mutex> lock(mutex);
+      space_ready.notify_one();
+    }
+  }
+
+  void write_published() {
+    size_t position = 0;
+    bool napped = false;
+    while (true) {
+      const size_t skip = skip_to.load(std::memory_order_acquire);
+      if (skip > position) {
+        discarded_bytes.fetch_add(skip - position);
+        position = skip;
+        publish_tail(position);
+      }
+      const size_t end = head.load(std::memory_order_acquire);
+      if (end != position) {
+        write_range(position, end);
+        position = end;
+        publish_tail(position);
+        napped = false;
+        continue;
+      }
+      if (stopping.load())
+        return;
+      // while lines keep coming, a short nap batches them into one write and
+      // spares the producer waking the writer (a system call) for every line
+      if (!napped) {
+        napped = true;
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(mutex);
+      writer_waiting.store(true);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      // a producer either sees the flag or its commit is seen here, the
+      // timeout is a safety net
+      if (!stopping.load() && head.load() == position &&
+          skip_to.load() <= position)
+        data_ready.wait_for(lock, std::chrono::milliseconds(10));
+      writer_waiting.store(false);
+    }
+  }
+};
+
+} // namespace stc
@@ -0,0 +1,117 @@
+/*
+MIT License
+
+Copyright (c) 2024 illyigan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "stc.hpp"
+#include <cstdlib>
+#include <iostream>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace stc {
+
+// Color mode supported by the terminal described by the environment, read
+// once per process:
+// - NO_COLOR set to anything but "" disables colors (https://no-color.org)
+// - TERM=dumb disables colors
+// - COLORTERM=truecolor or 24bit selects true color
+// - a TERM ending with "256color" selects 256 colors, other TERM values 16
+// Without TERM colors are disabled, except on Windows where the console
+// understands 256 color sequences.
+inline _color_modes _environment_color_mode() {
+  auto variable = [](const char *name) -> std::string_view {
+    const char *value = std::getenv(name);
+    return value != nullptr ? value : "";
+  };
+  if (!variable("NO_COLOR").empty())
+    return _color_modes::NO_COLOR;
+  const std::string_view term = variable("TERM");
+  if (term == "dumb")
+    return _color_modes::NO_COLOR;
+  const std::string_view colorterm = variable("COLORTERM");
+  if (colorterm == "truecolor" || colorterm == "24bit")
+    return _color_modes::TRUE_COLOR;
+  const std::string_view suffix = "256color";
+  if (term.size() >= suffix.size() &&
+      term.substr(term.size() - suffix.size()) == suffix)
+    return _color_modes::COLOR_256;
+  if (!term.empty())
+    return _color_modes::COLOR_16;
+#ifdef _WIN32
+  return _color_modes::COLOR_256;
+#else
+  return _color_modes::NO_COLOR;
+#endif
+}
+
+inline bool _is_terminal(int fd) {
+#ifdef _WIN32
+  return _isatty(fd) != 0;
+#else
+  return isatty(fd) != 0;
+#endif
+}
+
+// color mode for output to the file descriptor fd: NO_COLOR unless it is a
+// terminal, then the mode of the environment
+inline _color_modes detect_color_mode(int fd) {
+  static const _color_modes environment_mode = _environment_color_mode();
+  if (environment_mode == _color_modes::NO_COLOR)
+    return environment_mode;
+  return _is_terminal(fd) ? environment_mode : _color_modes::NO_COLOR;
+}
+
+// the modes of standard output and standard error, probed once per process
+inline _color_modes _stdout_color_mode() {
+  static const _color_modes mode = detect_color_mode(1);
+  return mode;
+}
+inline _color_modes _stderr_color_mode() {
+  static const _color_modes mode = detect_color_mode(2);
+  return mode;
+}
+
+// Sets the color mode of os to what its destination supports:
+//   std::cout << stc::auto_detect;
+// std::cout follows standard output and std::cerr and std::clog follow
+// standard error, probed with isatty and the environment the first time
+// they are needed; other streams (files, string streams) get NO_COLOR, which
+// writes no sequences at all. Detect before installing a filtering buffer,
+// streams are recognized by their buffer.
+inline std::ostream &auto_detect(std::ostream &os) {
+  _color_modes mode = _color_modes::NO_COLOR;
+  const std::streambuf *const buffer = os.rdbuf();
+  if (buffer == std::cout.rdbuf())
+    mode = _stdout_color_mode();
+  else if (buffer == std::cerr.rdbuf() || buffer == std::clog.rdbuf())
+    mode = _stderr_color_mode();
+  os.iword(_get_color_mode_index()) = mode;
+  return os;
+}
+
+} // namespace stc
@@ -0,0 +1,279 @@
+/*
+MIT License
+
+Copyright (c) 2024 illyigan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "stc.hpp"
+#include "stc_quantize.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace stc {
+
+// A fixed set of threads for fork-join work:
+//   stc::thread_pool pool; // one thread per core
+//   pool.run([&](unsigned index) { ... }); // index 0 to pool.size() - 1
+// The calling thread counts as one of them. run is not reentrant, and tasks
+// must not throw.
+class thread_pool {
+public:
+  // threads 0 uses one thread per core
+  explicit thread_pool(unsigned threads = 0) {
+    if (threads == 0)
+      threads = std::max(1U, std::thread::hardware_concurrency());
+    for (unsigned index = 1; index < threads; index++)
+      workers.emplace_back([this, index]() { work(index); });
+  }
+  thread_pool(const thread_pool &) = delete;
+  thread_pool &operator=(const thread_pool &) = delete;
+  ~thread_pool() {
+    {
+      const std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    start.notify_all();
+    for (std::thread &worker : workers)
+      worker.join();
+  }
+
+  unsigned size() const { return (unsigned)workers.size() + 1; }
+
+  // calls task(index) for every index below size(), each on its own thread,
+  // and returns when all calls have returned
+  void run(const std::function<void(unsigned)> &task) {
+    {
+      const std::lock_guard<std::mutex> lock(mutex);
+      job = &task;
+      generation++;
+      remaining = workers.size();
+    }
+    start.notify_all();
+    task(0);
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this]() { return remaining == 0; });
+    job = nullptr;
+  }
+
+private:
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable start, done;
+  const std::function<void(unsigned)> *job = nullptr;
+  unsigned long long generation = 0;
+  size_t remaining = 0;
+  bool stopping = false;
+
+  void work(unsigned index) {
+    unsigned long long seen = 0;
+    while (true) {
+      const std::function<void(unsigned)> *task;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        start.wait(lock, [&]() { return stopping || generation != seen; });
+        if (stopping)
+          return;
+        seen = generation;
+        task = job;
+      }
+      (*task)(index);
+      const std::lock_guard<std::mutex> lock(mutex);
+      if (--remaining == 0)
+        done.notify_one();
+    }
+  }
+};
+
+// Ordered dithering: a pixel's channels are moved by up to half the distance
+// between the palette levels around them, by an amount from an 8x8 Bayer
+// matrix (https://en.wikipedia.org/wiki/Ordered_dithering), so neighboring
+// pixels of a smooth area round to different levels. Every pixel is computed
+// on its own, rows are split between threads in blocks.
+class _bayer_thresholds {
+public:
+  // offsets in 1/128 of the level gap, from -63 to 63
+  signed char offset[8][8]{};
+  // distance between the cube levels bracketing a channel value
+  unsigned char gap[256]{};
+
+  constexpr _bayer_thresholds() {
+    for (int y = 0; y < 8; y++)
+      for (int x = 0; x < 8; x++) {
+        // the index of (x, y) in the matrix, bits of x ^ y and y interleaved
+        const int v = x ^ y;
+        const int m = ((v & 1) << 5) | ((y & 1) << 4) | ((v & 2) << 2) |
+                      ((y & 2) << 1) | ((v & 4) >> 1) | ((y & 4) >> 2);
+        offset[y][x] = (signed char)((2 * m) + 1 - 64);
+      }
+    for (int v = 0; v < 256; v++)
+      gap[v] = (unsigned char)(v < _cube_levels[1] ? _cube_levels[1] : 40);
+  }
+};
+
+inline constexpr _bayer_thresholds _bayer{};
+
+inline void _dither_bayer_rows(const uint8_t *rgb, size_t width,
+                               size_t first_row, size_t end_row,
+                               uint8_t *codes_out) {
+  std::vector<uint8_t> row(width * 3);
+  for (size_t y = first_row; y < end_row; y++) {
+    const uint8_t *in = rgb + (y * width * 3);
+    for (size_t x = 0; x < width; x++) {
+      const int offset = _bayer.offset[y & 7][x & 7];
+      for (size_t c = 0; c < 3; c++) {
+        const int v = in[(3 * x) + c];
+        const int moved = v + ((offset * _bayer.gap[v]) / 128);
+        row[(3 * x) + c] = (uint8_t)std::min(255, std::max(0, moved));
+      }
+    }
+    quantize_256(row.data(), width, codes_out + (y * width));
+  }
+}
+
+// Floyd-Steinberg error diffusion
+// (https://en.wikipedia.org/wiki/Floyd%E2%80%93Steinberg_dithering): the
+// rounding error of a pixel is spread over its right and lower neighbors in
+// 1/16 steps, in integers so that the result does not depend on how the work
+// is split. A row takes the error of the row above, so rows are dealt to the
+// threads in turn and run as a wavefront: a row only reads pixel x once the
+// row above is past pixel x + 1, which it publishes every few pixels.
+class _diffusion {
+public:
+  static constexpr size_t step = 64; // pixels between published progress
+
+  _diffusion(const uint8_t *rgb, size_t width, size_t height,
+             uint8_t *codes_out, unsigned threads)
+      : rgb(rgb), width(width), height(height), codes_out(codes_out),
+        threads(threads), slots(threads + 2), stride((width + 2) * 3),
+        errors(slots * stride), progress(new std::atomic<size_t>[height]) {
+    for (size_t y = 0; y < height; y++)
+      progress[y].store(0, std::memory_order_relaxed);
+  }
+
+  // the rows of thread index
+  void run(unsigned index) {
+    for (size_t y = index; y < height; y += threads)
+      diffuse_row(y);
+  }
+
+private:
+  const uint8_t *rgb;
+  size_t width, height;
+  uint8_t *codes_out;
+  size_t threads;
+  // The error a row receives from the one above, in 1/16, with a pixel of
+  // padding on both sides. Row y takes slot y % slots, which is reused once
+  // the row that read it before is done.
+  size_t slots, stride;
+  std::vector<int32_t> errors;
+  std::unique_ptr<std::atomic<size_t>[]> progress; // pixels done per row
+
+  int32_t *slot(size_t y) { return errors.data() + ((y % slots) * stride); }
+
+  void wait_for(size_t y, size_t pixels) {
+    while (progress[y].load(std::memory_order_acquire) < pixels)
+      std::this_thread::yield();
+  }
+
+  void diffuse_row(size_t y) {
+    const int32_t *const above = slot(y);
+    int32_t *const below = slot(y + 1);
+    if (y + 1 >= slots)
+      wait_for(y + 1 - slots, width);
+    std::fill(below, below + stride, 0);
+    const uint8_t *in = rgb + (y * width * 3);
+    uint8_t *out = codes_out + (y * width);
+    int32_t right[3] = {0, 0, 0}; // 7/16 of the error of the previous pixel
+    for (size_t x = 0; x < width; x++) {
+      if (y > 0 && x % step == 0)
+        wait_for(y - 1, std::min(x + step + 1, width));
+      int value[3];
+      for (size_t c = 0; c < 3; c++) {
+        const int32_t error = above[(3 * (x + 1)) + c] + right[c];
+        const int moved = in[(3 * x) + c] + ((error + 8) >> 4);
+        value[c] = std::min(255, std::max(0, moved));
+      }
+      const int code = _find_closest_color_code(value[0], value[1], value[2]);
+      out[x] = (uint8_t)code;
+      const int palette[3] = {(int)_256colors[code].r, (int)_256colors[code].g,
+                              (int)_256colors[code].b};
+      for (size_t c = 0; c < 3; c++) {
+        const int32_t error = value[c] - palette[c];
+        right[c] = 7 * error;
+        below[(3 * x) + c] += 3 * error;
+        below[(3 * (x + 1)) + c] += 5 * error;
+        below[(3 * (x + 2)) + c] += error;
+      }
+      if ((x + 1) % step == 0 || x + 1 == width)
+        progress[y].store(x + 1, std::memory_order_release);
+    }
+  }
+};
+
+enum dither_method { BAYER, FLOYD_STEINBERG };
+
+// Quantizes a width x height image of packed RGB pixels (3 bytes each, row
+// by row) to 256 color codes, with dithering against the banding of
+// quantize_256 on smooth gradients:
+//   std::vector<uint8_t> codes(width * height);
+//   stc::dither_256(pixels, width, height, codes.data(), stc::BAYER, pool);
+//   // then e.g. stc::code_bg(codes[(y * width) + x]) for each cell
+// BAYER (ordered) is cheap and stable between frames, FLOYD_STEINBERG
+// (error diffusion) reproduces colors more closely. The work is split
+// between the threads of pool, the codes do not depend on their number.
+inline void dither_256(const uint8_t *rgb, size_t width, size_t height,
+                       uint8_t *codes_out, dither_method method,
+                       thread_pool &pool) {
+  const unsigned threads = pool.size();
+  if (method == BAYER) {
+    const size_t rows = (height + threads - 1) / threads;
+    pool.run([&](unsigned index) {
+      const size_t first = std::min(height, index * rows);
+      _dither_bayer_rows(rgb, width, first, std::min(height, first + rows),
+                         codes_out);
+    });
+  } else {
+    _diffusion diffusion(rgb, width, height, codes_out, threads);
+    pool.run([&](unsigned index) { diffusion.run(index); });
+  }
+}
+
+// the same on the calling thread only
+inline void dither_256(const uint8_t *rgb, size_t width, size_t height,
+                       uint8_t *codes_out, dither_method method) {
+  if (method == BAYER) {
+    _dither_bayer_rows(rgb, width, 0, height, codes_out);
+  } else {
+    _diffusion diffusion(rgb, width, height, codes_out, 1);
+    diffusion.run(0);
+  }
+}
+
+} // namespace stc
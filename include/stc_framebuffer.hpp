@@ -0,0 +1,288 @@
+/*
+MIT License
+
+Copyright (c) 2024 illyigan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "stc.hpp"
+#include "stc_sgr_filter.hpp"
+#include <vector>
+
+namespace stc {
+
+// a color of a cell, with the codes used in each color mode
+class _cell_color {
+public:
+  // RGB colors are quantized when written, only in the modes that need it
+  enum kind_type : unsigned char { DEFAULT, COLOR, RGB };
+  unsigned char r = 0, g = 0, b = 0, code = 0, code_16 = 0, code_8 = 0;
+  unsigned char kind = DEFAULT;
+
+  static _cell_color from_rgb(int r, int g, int b) {
+    return {(unsigned char)r, (unsigned char)g, (unsigned char)b, 0, 0, 0,
+            RGB};
+  }
+  template <bool IS_FOREGROUND>
+  static _cell_color from_code(const _color_code<IS_FOREGROUND> &color) {
+    return {(unsigned char)color.r,
+            (unsigned char)color.g,
+            (unsigned char)color.b,
+            (unsigned char)color.code,
+            color.code_16,
+            color.code_8,
+            COLOR};
+  }
+
+  bool operator==(const _cell_color &other) const {
+    return kind == other.kind && r == other.r && g == other.g &&
+           b == other.b && code == other.code && code_16 == other.code_16 &&
+           code_8 == other.code_8;
+  }
+
+  _sgr_color sgr(long mode) const {
+    if (kind == DEFAULT)
+      return {};
+    if (mode == _color_modes::TRUE_COLOR)
+      return {_sgr_color::RGB, r, g, b};
+    // RGB colors, and colors whose system codes are found when written
+    if (kind == RGB ||
+        ((mode == _color_modes::COLOR_16 || mode == _color_modes::COLOR_8) &&
+         code_16 == _color_code<true>::no_system_code))
+      return quantized(mode).sgr(mode);
+    if (mode == _color_modes::COLOR_16)
+      return {_sgr_color::BASIC,
+              (unsigned char)(code_16 < 8 ? code_16 : 60 + (code_16 - 8)), 0,
+              0};
+    if (mode == _color_modes::COLOR_8)
+      return {_sgr_color::BASIC, code_8, 0, 0};
+    return {_sgr_color::INDEXED, code, 0, 0};
+  }
+
+  // the color with the codes used in the given mode filled in
+  _cell_color quantized(long mode) const {
+    _cell_color color = *this;
+    color.kind = COLOR;
+    if (mode == _color_modes::COLOR_256) {
+      color.code = (unsigned char)_find_closest_color_code(r, g, b);
+    } else {
+      int closest_16 = 0, closest_8 = 0;
+      _find_closest_system_color_codes(r, g, b, closest_16, closest_8);
+      color.code_16 = (unsigned char)closest_16;
+      color.code_8 = (unsigned char)closest_8;
+    }
+    return color;
+  }
+};
+
+// a character cell: one UTF-8 encoded glyph, its colors and attributes
+class _cell {
+public:
+  uint32_t glyph = ' '; // UTF-8 bytes, the first one in the lowest byte
+  _cell_color fg, bg;
+  unsigned short attributes = 0; // bit n is set for SGR parameter n
+
+  bool operator==(const _cell &other) const {
+    return glyph == other.glyph && attributes == other.attributes &&
+           fg == other.fg && bg == other.bg;
+  }
+  bool operator!=(const _cell &other) const { return !(*this == other); }
+};
+
+// A grid of character cells drawn off screen and presented as the difference
+// to the previous frame: only changed cells are written, with cursor moves
+// between them and SGR sequences that change just the colors and attributes
+// that differ from the previous written cell. The grid is positioned at the
+// top left corner of the screen and glyphs are assumed to be one column wide.
+//   stc::framebuffer screen(80, 24);
+//   screen.print(0, 0, "cpu", stc::rgb_fg(95, 21, 191) | stc::bold);
+//   screen.present(std::cout); // repeat drawing and presenting per frame
+// Cells are stored row by row in one array, so a frame is diffed in a single
+// linear pass over the current and the previous frame.
+class framebuffer {
+public:
+  framebuffer(int width, int height) {
+    if (width < 0 || width > 999 || height < 0 || height > 999)
+      throw std::invalid_argument("stc::framebuffer: size out of range");
+    columns = width;
+    rows = height;
+    back.resize((size_t)width * (size_t)height);
+    front = back;
+  }
+
+  int width() const { return columns; }
+  int height() const { return rows; }
+
+  // fills the frame with spaces in the given style
+  void clear(const style &s = {}) {
+    _cell blank;
+    apply(blank, s);
+    std::fill(back.begin(), back.end(), blank);
+  }
+
+  // writes text starting at column x of row y, characters outside of the
+  // frame are skipped and NUL is drawn as a space
+  void print(int x, int y, std::string_view text, const style &s = {}) {
+    if (y < 0 || y >= rows)
+      return;
+    _cell cell;
+    apply(cell, s);
+    for (size_t i = 0; i < text.size() && x < columns; x++) {
+      const size_t length = glyph_length(text[i]);
+      uint32_t glyph = 0;
+      for (size_t k = 0; k < length && i + k < text.size(); k++)
+        glyph |= (uint32_t)(unsigned char)text[i + k] << (8 * k);
+      i += length;
+      if (x < 0)
+        continue;
+      cell.glyph = glyph != 0 ? glyph : ' ';
+      back[((size_t)y * columns) + x] = cell;
+    }
+  }
+
+  // Half-block pixel mode: draws width x height packed RGB pixels (3 bytes
+  // each) with the top left pixel at cell column x, row y. Every cell shows
+  // two pixels stacked as a "▀" glyph, the upper one in the foreground and
+  // the lower one in the background color.
+  void draw_pixels(int x, int y, const uint8_t *rgb, int width, int height) {
+    for (int py = 0; py < height; py += 2) {
+      const int row = y + (py / 2);
+      if (row < 0 || row >= rows)
+        continue;
+      for (int px = 0; px < width; px++) {
+        const int column = x + px;
+        if (column < 0 || column >= columns)
+          continue;
+        const uint8_t *upper = rgb + (((size_t)py * width) + px) * 3;
+        _cell &cell = back[((size_t)row * columns) + column];
+        cell.glyph = 0x8096E2; // "▀"
+        cell.attributes = 0;
+        cell.fg = _cell_color::from_rgb(upper[0], upper[1], upper[2]);
+        if (py + 1 < height) {
+          const uint8_t *lower = upper + ((size_t)width * 3);
+          cell.bg = _cell_color::from_rgb(lower[0], lower[1], lower[2]);
+        } else {
+          cell.bg = {};
+        }
+      }
+    }
+  }
+
+  // the next frame is written in full, e.g. after the screen was cleared
+  void invalidate() { front_valid = false; }
+
+  // appends the bytes that turn the previous frame into the current one
+  void present(std::string &out, _color_modes mode) {
+    if (mode != front_mode) {
+      front_mode = mode;
+      front_valid = false;
+    }
+    _sgr_state terminal;
+    int cursor_row = -1, cursor_column = -1;
+    for (int row = 0; row < rows; row++) {
+      const size_t row_begin = (size_t)row * columns;
+      for (int column = 0; column < columns; column++) {
+        const _cell &cell = back[row_begin + column];
+        if (front_valid && cell == front[row_begin + column])
+          continue;
+        if (row != cursor_row || column != cursor_column)
+          move_cursor(out, row, column, cursor_row, cursor_column);
+        if (mode != _color_modes::NO_COLOR) {
+          _sgr_state wanted;
+          wanted.fg = cell.fg.sgr(mode);
+          wanted.bg = cell.bg.sgr(mode);
+          wanted.attributes = cell.attributes;
+          if (wanted != terminal) {
+            _basic_sequence<96> sequence;
+            sequence.append("\033[");
+            wanted.append_change(sequence, terminal);
+            sequence.append('m');
+            out.append(sequence.view());
+            terminal = wanted;
+          }
+        }
+        for (uint32_t glyph = cell.glyph; glyph != 0; glyph >>= 8)
+          out.push_back((char)(glyph & 0xFF));
+        cursor_row = row;
+        // after the last column the cursor position depends on the terminal
+        cursor_column = column + 1 < columns ? column + 1 : -1;
+      }
+    }
+    if (terminal != _sgr_state{})
+      out.append("\033[0m");
+    front = back;
+    front_valid = true;
+  }
+
+  // writes the changes with a single write in the color mode of the stream
+  void present(std::ostream &os) {
+    output.clear();
+    present(output, (_color_modes)os.iword(_get_color_mode_index()));
+    os.write(output.data(), (std::streamsize)output.size());
+  }
+
+private:
+  int columns = 0, rows = 0;
+  std::vector<_cell> back, front; // the frame being drawn and the shown one
+  bool front_valid = false;
+  _color_modes front_mode = _color_modes::COLOR_256;
+  std::string output; // reused between frames
+
+  static size_t glyph_length(char lead) {
+    const auto byte = (unsigned char)lead;
+    if (byte >= 0xF0 && byte < 0xF8)
+      return 4;
+    if (byte >= 0xE0 && byte < 0xF0)
+      return 3;
+    if (byte >= 0xC0 && byte < 0xE0)
+      return 2;
+    return 1;
+  }
+
+  static void apply(_cell &cell, const style &s) {
+    cell.attributes = s.attribute_bits();
+    cell.fg = s.has_fg() ? _cell_color::from_code(s.fg_color()) : _cell_color{};
+    cell.bg = s.has_bg() ? _cell_color::from_code(s.bg_color()) : _cell_color{};
+  }
+
+  static void move_cursor(std::string &out, int row, int column,
+                          int cursor_row, int cursor_column) {
+    _basic_sequence<12> sequence;
+    sequence.append("\033[");
+    if (row == cursor_row && cursor_column >= 0 && column > cursor_column) {
+      // forward on the same row: "\033[5C"
+      if (column - cursor_column > 1)
+        sequence.append_number(column - cursor_column);
+      sequence.append('C');
+    } else {
+      // "\033[12;40H", rows and columns are counted from 1
+      if (row != 0 || column != 0) {
+        sequence.append_number(row + 1);
+        sequence.append(';');
+        sequence.append_number(column + 1);
+      }
+      sequence.append('H');
+    }
+    out.append(sequence.view());
+  }
+};
+
+} // namespace stc
@@ -0,0 +1,246 @@
+/*
+MIT License
+
+Copyright (c) 2024 illyigan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "stc.hpp"
+#include <initializer_list>
+
+namespace stc {
+
+class _gradient_stop {
+public:
+  float x, y, z; // r, g, b in range 0-255 or h, s, l (v) in range 0-1
+};
+
+template <bool IS_FOREGROUND> class _gradient_text;
+
+// Colors interpolated over text, evenly spaced between the first and the last
+// character:
+//   constexpr auto rainbow = stc::gradient::hsl({{0, 1, 0.7}, {1, 1, 0.7}});
+//   cout << rainbow.fg("terminal output colors") << stc::reset;
+// Colors are stepped incrementally and a sequence is only written when the
+// emitted color changes, so outside of true color mode characters that
+// quantize to the same code share one sequence. Sequences are never placed
+// inside a UTF-8 encoded character.
+class gradient {
+public:
+  static constexpr size_t max_stops = 16;
+
+  static constexpr gradient rgb(std::initializer_list<_gradient_stop> stops) {
+    return {stops, RGB};
+  }
+  static constexpr gradient hsl(std::initializer_list<_gradient_stop> stops) {
+    return {stops, HSL};
+  }
+  static constexpr gradient hsv(std::initializer_list<_gradient_stop> stops) {
+    return {stops, HSV};
+  }
+
+  constexpr _gradient_text<true> fg(std::string_view text) const;
+  constexpr _gradient_text<false> bg(std::string_view text) const;
+
+  // calls write(std::string_view piece, bool is_sequence) with the pieces of
+  // the colored text, is_sequence is true for the sequences it adds
+  template <class WRITE>
+  void render(std::string_view text, bool is_foreground, long mode,
+              WRITE &&write) const {
+    if (mode == _color_modes::NO_COLOR || mode < 0 ||
+        mode >= _color_mode_count || stop_count == 0) {
+      write(text, false);
+      return;
+    }
+    size_t characters = 0;
+    for (const char c : text)
+      characters += _is_utf8_continuation(c) ? 0 : 1;
+    const size_t segments = stop_count - 1;
+    // position along the stops advances by `speed` segments per character
+    const float speed =
+        characters > 1 ? (float)segments / (float)(characters - 1) : 0;
+
+    size_t segment = 0, index = 0;
+    float position = 0, x = stops[0].x, y = stops[0].y, z = stops[0].z;
+    float dx = 0, dy = 0, dz = 0;
+    auto enter_segment = [&]() {
+      const _gradient_stop &from = stops[segment];
+      const _gradient_stop &to = stops[segment < segments ? segment + 1 : 0];
+      const float offset = position - (float)segment;
+      if (segment == segments) {
+        x = from.x, y = from.y, z = from.z;
+        dx = dy = dz = 0;
+        return;
+      }
+      dx = (to.x - from.x) * speed, dy = (to.y - from.y) * speed,
+      dz = (to.z - from.z) * speed;
+      x = from.x + ((to.x - from.x) * offset);
+      y = from.y + ((to.y - from.y) * offset);
+      z = from.z + ((to.z - from.z) * offset);
+    };
+    enter_segment();
+
+    int last_r = -1, last_g = -1, last_b = -1, last_code = -1;
+    size_t run_start = 0;
+    for (size_t i = 0; i < text.size(); i++) {
+      if (_is_utf8_continuation(text[i]))
+        continue;
+      position = (float)index * speed;
+      if (index != 0) {
+        const auto reached = std::min((size_t)position, segments);
+        if (reached != segment) {
+          segment = reached;
+          enter_segment();
+        } else {
+          x += dx, y += dy, z += dz;
+        }
+      }
+      index++;
+
+      int r = 0, g = 0, b = 0;
+      if (model == HSL) {
+        _hsl_to_rgb_fixed(x, y, z, r, g, b);
+      } else if (model == HSV) {
+        _hsv_to_rgb_fixed(x, y, z, r, g, b);
+      } else {
+        r = (int)(x + 0.5F), g = (int)(y + 0.5F), b = (int)(z + 0.5F);
+      }
+      _clamp_rgb(r, g, b);
+      if (mode != _color_modes::TRUE_COLOR) {
+        int code = 0, code_16 = 0, code_8 = 0;
+        if (mode == _color_modes::COLOR_256)
+          code = _find_closest_color_code(r, g, b);
+        else
+          _find_closest_system_color_codes(r, g, b, code_16, code_8);
+        if (mode == _color_modes::COLOR_16)
+          code = code_16;
+        else if (mode == _color_modes::COLOR_8)
+          code = code_8;
+        if (code == last_code)
+          continue;
+        last_code = code;
+      } else {
+        if (r == last_r && g == last_g && b == last_b)
+          continue;
+        last_r = r, last_g = g, last_b = b;
+      }
+      write(text.substr(run_start, i - run_start), false);
+      run_start = i;
+      if (mode != _color_modes::TRUE_COLOR) {
+        write(_indexed_color_sequence(is_foreground, mode, last_code), true);
+      } else {
+        const _sequence sequence =
+            _render_color_sequence(is_foreground, true, r, g, b, 0);
+        write(sequence.view(), true);
+      }
+    }
+    write(text.substr(run_start), false);
+  }
+
+private:
+  enum color_model : unsigned char { RGB, HSL, HSV };
+
+  _gradient_stop stops[max_stops]{};
+  size_t stop_count = 0;
+  color_model model = RGB;
+
+  constexpr gradient(std::initializer_list<_gradient_stop> list,
+                     color_model model)
+      : model(model) {
+    for (const _gradient_stop &stop : list)
+      if (stop_count < max_stops)
+        stops[stop_count++] = stop;
+  }
+
+  static constexpr bool _is_utf8_continuation(char c) {
+    return ((unsigned char)c & 0xC0) == 0x80;
+  }
+};
+
+// holds a copy of the gradient, so that it can outlive a temporary one, the
+// text is not copied
+template <bool IS_FOREGROUND> class _gradient_text {
+public:
+  gradient colors;
+  std::string_view text;
+
+  // upper bound of the rendered size, for sizing buffers
+  constexpr size_t max_size() const {
+    return text.size() * (1 + sizeof(_sequence::data));
+  }
+
+  template <class WRITE> void render(long mode, WRITE &&write) const {
+    colors.render(text, IS_FOREGROUND, mode, write);
+  }
+};
+
+constexpr _gradient_text<true> gradient::fg(std::string_view text) const {
+  return {*this, text};
+}
+constexpr _gradient_text<false> gradient::bg(std::string_view text) const {
+  return {*this, text};
+}
+
+template <bool IS_FOREGROUND>
+inline std::ostream &operator<<(std::ostream &os,
+                                const _gradient_text<IS_FOREGROUND> &text) {
+  // pieces are gathered so that the stream sees a few large writes
+  char buffer[512];
+  size_t size = 0;
+  auto flush = [&]() {
+    os.write(buffer, (std::streamsize)size);
+    size = 0;
+  };
+  const long mode = os.iword(_get_color_mode_index());
+  if (mode == _color_modes::NO_COLOR)
+    _count_sequence(os, stream_stats::COLOR, mode, 0);
+  text.render(mode, [&](std::string_view piece, bool is_sequence) {
+    if (is_sequence)
+      _count_sequence(os, stream_stats::COLOR, mode, piece.size());
+    if (size + piece.size() > sizeof(buffer)) {
+      flush();
+      if (piece.size() > sizeof(buffer)) {
+        os.write(piece.data(), (std::streamsize)piece.size());
+        return;
+      }
+    }
+    std::char_traits<char>::copy(buffer + size, piece.data(), piece.size());
+    size += piece.size();
+  });
+  flush();
+  return os;
+}
+
+// the buffer must have room for text.max_size() bytes
+template <bool IS_FOREGROUND>
+inline void append(char *&out, const _gradient_text<IS_FOREGROUND> &text,
+                   _color_modes mode) {
+  text.render(mode,
+              [&](std::string_view piece, bool) { append(out, piece); });
+}
+template <bool IS_FOREGROUND>
+inline void append(std::string &out, const _gradient_text<IS_FOREGROUND> &text,
+                   _color_modes mode) {
+  text.render(mode,
+              [&](std::string_view piece, bool) { out.append(piece); });
+}
+
+} // namespace stc
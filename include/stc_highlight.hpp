@@ -0,0 +1,384 @@
+/*
+MIT License
+
+Copyright (c) 2024 illyigan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "stc.hpp"
+#include <cstdint>
+#include <initializer_list>
+#include <stdexcept>
+#include <streambuf>
+#include <vector>
+
+namespace stc {
+
+// a keyword and the style of its matches, e.g. {"ERROR", stc::rgb_fg(255, 0,
+// 0) | stc::bold}
+class highlight_rule {
+public:
+  std::string keyword;
+  style highlight;
+};
+
+// Aho-Corasick automaton over the keywords of the rules. Bytes are mapped to
+// classes first, one for each byte used by a keyword and class 0 for all
+// others, so the transition table has a row of a few entries per state
+// instead of 256 and the table of a typical rule set fits in the L1 cache.
+// Transitions are complete (failure links are resolved when building). A
+// state is the offset of its row, rows are a power of two entries long, and
+// its lowest bit tells if a keyword ends in it, so a byte costs two dependent
+// lookups and no multiplication.
+class _keyword_automaton {
+public:
+  static constexpr uint32_t root = 0, no_match = 0xFFFFFFFF;
+
+  _keyword_automaton() = default;
+  explicit _keyword_automaton(const std::vector<highlight_rule> &rules) {
+    unsigned classes = 1;
+    for (const highlight_rule &rule : rules)
+      for (const char c : rule.keyword)
+        if (byte_class[(unsigned char)c] == 0)
+          byte_class[(unsigned char)c] = (unsigned char)classes++;
+    while ((1U << shift) < classes)
+      shift++;
+    const uint32_t stride = 1U << shift;
+    // the trie, of state indexes, where 0 (root) stands for a missing edge
+    std::vector<uint32_t> trie(stride);
+    depth.push_back(0);
+    match.push_back(no_match);
+    match_length.push_back(0);
+    for (size_t r = 0; r < rules.size(); r++) {
+      const std::string &keyword = rules[r].keyword;
+      if (keyword.empty())
+        continue;
+      uint32_t state = 0;
+      for (const char c : keyword) {
+        const size_t edge = ((size_t)state << shift) + byte_class[(uint8_t)c];
+        if (trie[edge] == 0) {
+          if (depth.size() >= (0x80000000U >> shift))
+            throw std::length_error("stc::highlighter: too many keyword bytes");
+          trie[edge] = (uint32_t)depth.size();
+          trie.resize(trie.size() + stride);
+          depth.push_back(depth[state] + 1);
+          match.push_back(no_match);
+          match_length.push_back(0);
+        }
+        state = trie[edge];
+      }
+      // of rules with the same keyword the first one wins
+      if (match[state] == no_match) {
+        match[state] = (uint32_t)r;
+        match_length[state] = (unsigned)keyword.size();
+      }
+    }
+    // breadth first, a state's failure state is shallower and complete when
+    // the state is reached, so missing edges are taken from its row
+    std::vector<uint32_t> failure(depth.size()), queue{0};
+    for (size_t i = 0; i < queue.size(); i++) {
+      const uint32_t state = queue[i];
+      if (state != 0 && match[state] == no_match) {
+        // the longest keyword ending here is one of a suffix
+        match[state] = match[failure[state]];
+        match_length[state] = match_length[failure[state]];
+      }
+      for (unsigned c = 0; c < classes; c++) {
+        uint32_t &target = trie[((size_t)state << shift) + c];
+        const uint32_t failure_target =
+            trie[((size_t)failure[state] << shift) + c];
+        if (target != 0) {
+          failure[target] = state == 0 ? 0 : failure_target;
+          queue.push_back(target);
+        } else {
+          target = failure_target;
+        }
+      }
+    }
+    transitions.resize(trie.size());
+    for (size_t i = 0; i < trie.size(); i++)
+      transitions[i] = (trie[i] << shift) | (match[trie[i]] != no_match);
+  }
+
+  uint32_t next(uint32_t state, unsigned char byte) const {
+    return transitions[(state & ~1U) + byte_class[byte]];
+  }
+  static bool is_match(uint32_t state) { return (state & 1) != 0; }
+  // length of the longest suffix of the input that a keyword starts with
+  unsigned depth_of(uint32_t state) const { return depth[state >> shift]; }
+  // rule and length of the longest keyword ending in the state, the rule is
+  // no_match if there is none
+  uint32_t match_of(uint32_t state) const { return match[state >> shift]; }
+  unsigned match_length_of(uint32_t state) const {
+    return match_length[state >> shift];
+  }
+
+private:
+  unsigned char byte_class[256]{};
+  unsigned shift = 1;
+  std::vector<uint32_t> transitions; // a row of 1 << shift entries per state
+  std::vector<unsigned> depth, match_length;
+  std::vector<uint32_t> match;
+};
+
+// A streambuf that colors keywords in everything written through it, e.g. to
+// highlight a log as it is written:
+//   stc::highlighter h(std::cout, {{"ERROR", stc::rgb_fg(255, 0, 0)},
+//                                  {"WARN", stc::rgb_fg(255, 200, 0)},
+//                                  {"req-", stc::code_fg(51)}});
+//   std::cout << "ERROR: disk full\n"; // until h is destroyed
+// A match is written between the sequence of its rule's style and a reset,
+// in the color mode of the stream (nothing is added in NO_COLOR mode). Where
+// matches overlap the one that starts first wins, and of those the longest.
+// Matches may be split between writes, only bytes that can still be part of
+// a match are held back, and flushing writes them out. Escape sequences in
+// the text are passed through and never matched.
+class highlighter : public std::streambuf {
+public:
+  highlighter(std::streambuf *target, std::vector<highlight_rule> rules,
+              _color_modes mode)
+      : target_buf(target), mode(mode), rules(std::move(rules)),
+        automaton(this->rules) {
+    setp(input, input + sizeof(input));
+  }
+  highlighter(std::streambuf *target,
+              std::initializer_list<highlight_rule> rules, _color_modes mode)
+      : highlighter(target, std::vector<highlight_rule>(rules), mode) {}
+  // highlights in the color mode of os, also after it changes
+  highlighter(std::ostream &os, std::vector<highlight_rule> rules)
+      : highlighter(os.rdbuf(), std::move(rules),
+                    (_color_modes)os.iword(_get_color_mode_index())) {
+    installed_on = &os;
+    os.rdbuf(this);
+  }
+  highlighter(std::ostream &os, std::initializer_list<highlight_rule> rules)
+      : highlighter(os, std::vector<highlight_rule>(rules)) {}
+  highlighter(const highlighter &) = delete;
+  highlighter &operator=(const highlighter &) = delete;
+  ~highlighter() override {
+    highlighter::sync();
+    if (installed_on != nullptr)
+      installed_on->rdbuf(target_buf);
+  }
+
+  std::streambuf *target() const { return target_buf; }
+
+protected:
+  int_type overflow(int_type c) override {
+    process(pbase(), (size_t)(pptr() - pbase()));
+    setp(input, input + sizeof(input));
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+      const char ch = traits_type::to_char_type(c);
+      process(&ch, 1);
+    }
+    return traits_type::not_eof(c);
+  }
+
+  int sync() override {
+    process(pbase(), (size_t)(pptr() - pbase()));
+    setp(input, input + sizeof(input));
+    finish();
+    flush_output();
+    return target_buf->pubsync();
+  }
+
+private:
+  std::streambuf *target_buf;
+  std::ostream *installed_on = nullptr;
+  _color_modes mode;
+  std::vector<highlight_rule> rules;
+  _keyword_automaton automaton;
+  uint32_t state = _keyword_automaton::root;
+  // Offsets count the bytes written to the highlighter. The bytes from
+  // emitted to position are not written yet: the held back ones from
+  // pending_start in pending, then the ones of the buffer being processed.
+  size_t position = 0, emitted = 0, pending_start = 0, buffer_start = 0;
+  std::string pending;
+  const char *buffer = nullptr;
+  // the best match found so far, if best_length is not 0
+  size_t best_start = 0, best_length = 0;
+  uint32_t best_rule = 0;
+  // escape sequences already in the text are written as they are
+  enum escape_state : unsigned char { TEXT, ESCAPE, CSI } escape = TEXT;
+  char input[1024];
+  char output[1024];
+  size_t output_size = 0;
+
+  long current_mode() const {
+    return installed_on != nullptr
+               ? installed_on->iword(_get_color_mode_index())
+               : (long)mode;
+  }
+
+  void flush_output() {
+    target_buf->sputn(output, (std::streamsize)output_size);
+    output_size = 0;
+  }
+
+  void emit(const char *data, size_t size) {
+    if (output_size + size > sizeof(output)) {
+      flush_output();
+      if (size > sizeof(output)) {
+        target_buf->sputn(data, (std::streamsize)size);
+        return;
+      }
+    }
+    std::char_traits<char>::copy(output + output_size, data, size);
+    output_size += size;
+  }
+  void emit(std::string_view text) { emit(text.data(), text.size()); }
+
+  char byte_at(size_t offset) const {
+    return offset >= buffer_start ? buffer[offset - buffer_start]
+                                  : pending[offset - pending_start];
+  }
+
+  // writes the bytes up to offset end
+  void emit_to(size_t end) {
+    if (emitted < buffer_start) {
+      const size_t pending_end = end < buffer_start ? end : buffer_start;
+      emit(pending.data() + (emitted - pending_start), pending_end - emitted);
+      emitted = pending_end;
+    }
+    if (end > emitted) {
+      emit(buffer + (emitted - buffer_start), end - emitted);
+      emitted = end;
+    }
+  }
+
+  // writes the best match and the text before it, returns the offset after
+  // it, where scanning starts again
+  size_t commit() {
+    const long current = current_mode();
+    emit_to(best_start);
+    const std::string_view sequence =
+        rules[best_rule].highlight.sequence(current);
+    const bool colored = current != _color_modes::NO_COLOR && !sequence.empty();
+    if (colored)
+      emit(sequence);
+    emit_to(best_start + best_length);
+    if (colored)
+      emit("\033[0m");
+    best_length = 0;
+    state = _keyword_automaton::root;
+    return emitted;
+  }
+
+  // follows the bytes of the buffer from offset on that complete no keyword
+  // and are not escapes, the common case, returns the offset of the next one
+  size_t skip(size_t offset) {
+    const char *data = buffer + (offset - buffer_start);
+    const char *const end = buffer + (position - buffer_start);
+    uint32_t current = state;
+    while (data != end && *data != '\033') {
+      const uint32_t next = automaton.next(current, (unsigned char)*data);
+      if (_keyword_automaton::is_match(next))
+        break;
+      current = next;
+      data++;
+    }
+    state = current;
+    return buffer_start + (size_t)(data - buffer);
+  }
+
+  void scan(size_t offset) {
+    while (offset != position) {
+      if (best_length == 0 && escape == TEXT && offset >= buffer_start) {
+        offset = skip(offset);
+        if (offset == position)
+          break;
+      }
+      const char c = byte_at(offset++);
+      if (escape != TEXT) {
+        if (escape == ESCAPE && c == '[')
+          escape = CSI;
+        else if (escape == ESCAPE || (c >= 0x40 && c <= 0x7E))
+          escape = TEXT;
+        continue;
+      }
+      if (c == '\033') {
+        // no match spans an escape sequence
+        if (best_length != 0) {
+          offset = commit();
+          continue;
+        }
+        state = _keyword_automaton::root;
+        escape = ESCAPE;
+        continue;
+      }
+      state = automaton.next(state, (unsigned char)c);
+      if (_keyword_automaton::is_match(state)) {
+        const uint32_t rule = automaton.match_of(state);
+        const size_t length = automaton.match_length_of(state);
+        const size_t start = offset - length;
+        if (best_length == 0 || start < best_start ||
+            (start == best_start && length > best_length)) {
+          best_start = start;
+          best_length = length;
+          best_rule = rule;
+        }
+      }
+      // a match that is still to come starts with the current partial match,
+      // once that starts after the best match no later one can replace it
+      if (best_length != 0 && offset - automaton.depth_of(state) > best_start)
+        offset = commit();
+    }
+  }
+
+  void process(const char *data, size_t size) {
+    buffer = data;
+    buffer_start = position;
+    position += size;
+    if (current_mode() == _color_modes::NO_COLOR && emitted == buffer_start &&
+        state == _keyword_automaton::root && escape == TEXT) {
+      emit(data, size);
+      emitted = position;
+    } else {
+      scan(buffer_start);
+      // hold back only the bytes that may still be part of a match, the
+      // partial match may start before the best one and replace it
+      const size_t partial_start = position - automaton.depth_of(state);
+      emit_to(best_length != 0 && best_start < partial_start ? best_start
+                                                             : partial_start);
+    }
+    if (emitted < buffer_start) {
+      pending.erase(0, emitted - pending_start);
+      pending.append(data, size);
+    } else {
+      pending.assign(data + (emitted - buffer_start), position - emitted);
+    }
+    pending_start = emitted;
+    buffer = nullptr;
+    buffer_start = position;
+  }
+
+  // writes the held back bytes, a match can not continue past a flush
+  void finish() {
+    while (best_length != 0)
+      scan(commit());
+    emit_to(position);
+    pending.clear();
+    pending_start = emitted;
+    state = _keyword_automaton::root;
+  }
+};
+
+} // namespace stc
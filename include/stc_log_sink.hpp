@@ -0,0 +1,309 @@
+/*
+MIT License
+
+Copyright (c) 2024 illyigan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "stc.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace stc {
+
+// a published piece of text, allocated together with its bytes
+class _log_record {
+public:
+  std::atomic<_log_record *> next{nullptr};
+  size_t size = 0;
+
+  static _log_record *create(std::string_view text) {
+    void *memory = ::operator new(sizeof(_log_record) + text.size());
+    auto *record = new (memory) _log_record;
+    record->size = text.size();
+    std::char_traits<char>::copy(record->data(), text.data(), text.size());
+    return record;
+  }
+  static void destroy(_log_record *record) {
+    record->~_log_record();
+    ::operator delete(record);
+  }
+
+  char *data() { return reinterpret_cast<char *>(this + 1); }
+  std::string_view text() { return {data(), size}; }
+};
+
+// Multiple producer, single consumer queue of records, an intrusive linked
+// list (https://www.1024cores.net/home/lock-free-algorithms/queues/
+// intrusive-mpsc-node-based-queue). Producers only exchange the head pointer,
+// so publishing never blocks.
+class _log_queue {
+public:
+  _log_queue() = default;
+  _log_queue(const _log_queue &) = delete;
+  _log_queue &operator=(const _log_queue &) = delete;
+  ~_log_queue() {
+    while (_log_record *record = pop())
+      _log_record::destroy(record);
+  }
+
+  void push(_log_record *record) {
+    record->next.store(nullptr, std::memory_order_relaxed);
+    _log_record *const previous =
+        head.exchange(record, std::memory_order_acq_rel);
+    previous->next.store(record, std::memory_order_release);
+  }
+
+  // consumer only, false while a push is halfway
+  bool empty() const {
+    return tail == &stub &&
+           stub.next.load(std::memory_order_acquire) == nullptr;
+  }
+
+  // consumer only, returns nullptr when empty (or while a push is halfway)
+  _log_record *pop() {
+    _log_record *first = tail;
+    _log_record *next = first->next.load(std::memory_order_acquire);
+    if (first == &stub) {
+      if (next == nullptr)
+        return nullptr;
+      tail = first = next;
+      next = next->next.load(std::memory_order_acquire);
+    }
+    if (next != nullptr) {
+      tail = next;
+      return first;
+    }
+    if (first != head.load(std::memory_order_acquire))
+      return nullptr;
+    push(&stub);
+    next = first->next.load(std::memory_order_acquire);
+    if (next == nullptr)
+      return nullptr;
+    tail = next;
+    return first;
+  }
+
+private:
+  _log_record stub;
+  std::atomic<_log_record *> head{&stub};
+  _log_record *tail = &stub;
+};
+
+// state shared by a sink, its writer thread and the streams of each thread
+class _log_core {
+public:
+  _log_queue queue;
+  std::mutex mutex; // only taken to sleep and to wake the writer
+  std::condition_variable wake;
+  std::atomic<bool> writer_waiting{false};
+  std::atomic<bool> closed{false};
+
+  void publish(std::string_view text) {
+    queue.push(_log_record::create(text));
+    // pairs with the fence in log_sink::write_records
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    // only the first producer to see the writer asleep pays for waking it
+    if (writer_waiting.load() && writer_waiting.exchange(false)) {
+      const std::lock_guard<std::mutex> lock(mutex);
+      wake.notify_one();
+    }
+  }
+};
+
+// collects the output of one thread and publishes it a line at a time
+class _log_buffer : public std::streambuf {
+public:
+  explicit _log_buffer(std::shared_ptr<_log_core> core)
+      : core(std::move(core)) {}
+  _log_buffer(const _log_buffer &) = delete;
+  _log_buffer &operator=(const _log_buffer &) = delete;
+  ~_log_buffer() override { _log_buffer::sync(); }
+
+  const _log_core &shared() const { return *core; }
+
+protected:
+  int_type overflow(int_type c) override {
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+      const char ch = traits_type::to_char_type(c);
+      xsputn(&ch, 1);
+    }
+    return traits_type::not_eof(c);
+  }
+
+  std::streamsize xsputn(const char *data, std::streamsize size) override {
+    pending.append(data, (size_t)size);
+    if (std::char_traits<char>::find(data, (size_t)size, '\n') != nullptr)
+      publish_lines();
+    return size;
+  }
+
+  // flushing publishes a partial line as well
+  int sync() override {
+    if (!pending.empty())
+      core->publish(pending);
+    pending.clear();
+    return 0;
+  }
+
+private:
+  std::shared_ptr<_log_core> core;
+  std::string pending;
+
+  void publish_lines() {
+    const size_t end = pending.rfind('\n') + 1;
+    core->publish(std::string_view(pending).substr(0, end));
+    pending.erase(0, end);
+  }
+};
+
+class _log_stream {
+public:
+  _log_buffer buffer;
+  std::ostream os{&buffer};
+
+  _log_stream(std::shared_ptr<_log_core> core, long mode)
+      : buffer(std::move(core)) {
+    os.iword(_get_color_mode_index()) = mode;
+  }
+};
+
+// A sink that lets many threads write colored lines to one stream without
+// interleaving their escape sequences:
+//   stc::log_sink sink(std::cout);
+//   // in any thread:
+//   sink.stream() << stc::rgb_fg(95, 21, 191) << "worker" << stc::reset
+//                 << " started\n";
+// Every thread gets its own std::ostream, with its own color mode (starting
+// with the mode of the target stream). Text is buffered per thread and
+// published a whole line at a time (or on flush) through a lock-free queue
+// to a writer thread, the only one that touches the target stream. Lines
+// written after the sink is destroyed are discarded.
+class log_sink {
+public:
+  explicit log_sink(std::ostream &target)
+      : target(target), mode(target.iword(_get_color_mode_index())),
+        id(_next_id()), core(std::make_shared<_log_core>()),
+        writer([this]() { write_records(); }) {}
+  log_sink(const log_sink &) = delete;
+  log_sink &operator=(const log_sink &) = delete;
+
+  // writes everything published so far before returning
+  ~log_sink() {
+    {
+      const std::lock_guard<std::mutex> lock(core->mutex);
+      core->closed.store(true);
+      core->wake.notify_one();
+    }
+    writer.join();
+  }
+
+  // the calling thread's stream for this sink
+  std::ostream &stream() {
+    auto &streams = _thread_streams();
+    for (auto &entry : streams)
+      if (entry.first == id)
+        return entry.second->os;
+    // streams of destroyed sinks are dropped when a new one is added
+    streams.erase(std::remove_if(streams.begin(), streams.end(),
+                                 [](const auto &entry) {
+                                   return entry.second->buffer.shared()
+                                       .closed.load();
+                                 }),
+                  streams.end());
+    streams.emplace_back(id, std::make_unique<_log_stream>(core, mode));
+    return streams.back().second->os;
+  }
+
+private:
+  std::ostream &target;
+  long mode;
+  unsigned long long id;
+  std::shared_ptr<_log_core> core;
+  std::thread writer;
+
+  static unsigned long long _next_id() {
+    static std::atomic<unsigned long long> next{0};
+    return next++;
+  }
+
+  static std::vector<
+      std::pair<unsigned long long, std::unique_ptr<_log_stream>>> &
+  _thread_streams() {
+    thread_local std::vector<
+        std::pair<unsigned long long, std::unique_ptr<_log_stream>>>
+        streams;
+    return streams;
+  }
+
+  // writes all queued records with one write, returns false if there were
+  // none
+  bool write_queued(std::string &output) {
+    output.clear();
+    while (_log_record *record = core->queue.pop()) {
+      output.append(record->text());
+      _log_record::destroy(record);
+    }
+    if (output.empty())
+      return false;
+    target.write(output.data(), (std::streamsize)output.size());
+    return true;
+  }
+
+  void write_records() {
+    std::string output;
+    bool napped = false;
+    while (true) {
+      const bool closing = core->closed.load();
+      if (write_queued(output)) {
+        napped = false;
+        continue;
+      }
+      target.flush();
+      if (closing)
+        return;
+      // while lines keep coming, a short nap batches them into one write
+      // instead of waking up (a context switch) for every line
+      if (!napped) {
+        napped = true;
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(core->mutex);
+      core->writer_waiting.store(true);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      // a producer either sees the flag or its record is seen below, the
+      // timeout covers a push that was halfway when the queue was read
+      if (!core->closed.load() && core->queue.empty())
+        core->wake.wait_for(lock, std::chrono::milliseconds(10));
+      core->writer_waiting.store(false);
+    }
+  }
+};
+
+} // namespace stc
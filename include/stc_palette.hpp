@@ -0,0 +1,208 @@
+/*
+MIT License
+
+Copyright (c) 2024 illyigan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "stc.hpp"
+#include <initializer_list>
+#include <vector>
+
+namespace stc {
+
+class _palette_color {
+public:
+  int r, g, b; // in range 0-255
+};
+
+// Nearest color search over an arbitrary list of colors. The RGB cube is
+// split into 16x16x16 cells and each cell keeps the colors that can be the
+// nearest to some point inside it: redmean weighs red and blue by 2-3 and
+// green by 4, so a color whose smallest possible distance to the cell
+// (weights 2, 4, 2) exceeds the largest possible distance of another color
+// (weights 3, 4, 3) never wins there. Candidates are compared in list order
+// with the redmean distance, so results equal a scan of the whole list.
+class _palette_index {
+public:
+  _palette_index() = default;
+  _palette_index(const _color_data *list, size_t count)
+      : colors(list, list + count), cell_begin((cells * cells * cells) + 1) {
+    for (int cell = 0; cell < cells * cells * cells; cell++) {
+      cell_begin[cell] = (unsigned)candidates.size();
+      const int low[3] = {(cell / (cells * cells)) * cell_size,
+                          ((cell / cells) % cells) * cell_size,
+                          (cell % cells) * cell_size};
+      int threshold = 0;
+      for (size_t i = 0; i < colors.size(); i++) {
+        const int upper = bound(colors[i], low, false);
+        if (i == 0 || upper < threshold)
+          threshold = upper;
+      }
+      for (size_t i = 0; i < colors.size(); i++)
+        if (bound(colors[i], low, true) <= threshold)
+          candidates.push_back((unsigned char)i);
+    }
+    cell_begin.back() = (unsigned)candidates.size();
+  }
+
+  // position of the closest color in the list, r, g, b must be in range 0-255
+  int find(int r, int g, int b) const {
+    const int cell = ((r / cell_size) * cells * cells) +
+                     ((g / cell_size) * cells) + (b / cell_size);
+    const unsigned char *candidate = candidates.data() + cell_begin[cell];
+    const unsigned char *const end = candidates.data() + cell_begin[cell + 1];
+    int best_index = *candidate;
+    float best_distance = _color_distance(r, g, b, colors[*candidate]);
+    for (++candidate; candidate != end; ++candidate) {
+      const float distance = _color_distance(r, g, b, colors[*candidate]);
+      if (distance < best_distance) {
+        best_distance = distance;
+        best_index = *candidate;
+      }
+    }
+    return best_index;
+  }
+
+private:
+  static constexpr int cells = 16, cell_size = 256 / cells;
+
+  std::vector<_color_data> colors;
+  std::vector<unsigned> cell_begin;     // candidates of a cell, and the end
+  std::vector<unsigned char> candidates; // positions in colors
+
+  // lower or upper bound of the redmean distance from the color to the cell
+  static int bound(const _color_data &color, const int (&low)[3],
+                   bool is_lower) {
+    const int channels[3] = {(int)color.r, (int)color.g, (int)color.b};
+    const int lower_weights[3] = {2, 4, 2}, upper_weights[3] = {3, 4, 3};
+    int sum = 0;
+    for (int c = 0; c < 3; c++) {
+      const int begin = low[c], end = low[c] + cell_size - 1;
+      int difference = 0;
+      if (is_lower)
+        difference = channels[c] < begin
+                         ? begin - channels[c]
+                         : (channels[c] > end ? channels[c] - end : 0);
+      else
+        difference = std::max(channels[c] - begin, end - channels[c]);
+      sum += (is_lower ? lower_weights[c] : upper_weights[c]) * difference *
+             difference;
+    }
+    return sum;
+  }
+};
+
+// The colors of a terminal with a known palette, color code n is the n-th
+// color of the list. Colors created by a palette use its closest codes in
+// 256 color mode, and the closest of its first 16 and 8 colors in 16 and 8
+// color mode:
+//   const stc::palette solarized({{7, 54, 66}, {220, 50, 47}, ...});
+//   cout << solarized.rgb_fg(38, 139, 210) << "blue" << stc::reset;
+// The search index is built once, when the palette is constructed.
+class palette {
+public:
+  static constexpr size_t max_colors = 256;
+
+  palette(std::initializer_list<_palette_color> colors) {
+    std::vector<_color_data> list;
+    for (const _palette_color &color : colors) {
+      int r = color.r, g = color.g, b = color.b;
+      _clamp_rgb(r, g, b);
+      list.emplace_back(r, g, b, (int)list.size() % 256);
+    }
+    build(list);
+  }
+  // n packed RGB colors (3 bytes each)
+  palette(const uint8_t *rgb, size_t n) {
+    std::vector<_color_data> list;
+    for (size_t i = 0; i < n; i++, rgb += 3)
+      list.emplace_back(rgb[0], rgb[1], rgb[2], (int)i % 256);
+    build(list);
+  }
+
+  size_t size() const { return count; }
+
+  // code of the closest color
+  int find(int r, int g, int b) const {
+    _clamp_rgb(r, g, b);
+    return index.find(r, g, b);
+  }
+
+  _color_code<true> rgb_fg(int r, int g, int b) const {
+    return color<true>(r, g, b);
+  }
+  _color_code<false> rgb_bg(int r, int g, int b) const {
+    return color<false>(r, g, b);
+  }
+  _color_code<true> hsl_fg(float h, float s, float l) const {
+    int r = 0, g = 0, b = 0;
+    _hsl_to_rgb_fixed(h, s, l, r, g, b);
+    return color<true>(r, g, b);
+  }
+  _color_code<false> hsl_bg(float h, float s, float l) const {
+    int r = 0, g = 0, b = 0;
+    _hsl_to_rgb_fixed(h, s, l, r, g, b);
+    return color<false>(r, g, b);
+  }
+  _color_code<true> hsv_fg(float h, float s, float v) const {
+    int r = 0, g = 0, b = 0;
+    _hsv_to_rgb_fixed(h, s, v, r, g, b);
+    return color<true>(r, g, b);
+  }
+  _color_code<false> hsv_bg(float h, float s, float v) const {
+    int r = 0, g = 0, b = 0;
+    _hsv_to_rgb_fixed(h, s, v, r, g, b);
+    return color<false>(r, g, b);
+  }
+
+  // converts n packed RGB pixels (3 bytes each) to codes of this palette
+  void quantize(const uint8_t *rgb, size_t n, uint8_t *codes_out) const {
+    for (size_t i = 0; i < n; i++, rgb += 3)
+      codes_out[i] = (uint8_t)index.find(rgb[0], rgb[1], rgb[2]);
+  }
+
+private:
+  size_t count = 0;
+  _palette_index index, index_16, index_8;
+
+  void build(const std::vector<_color_data> &list) {
+    if (list.empty() || list.size() > max_colors)
+      throw std::invalid_argument("stc::palette: needs 1 to 256 colors");
+    count = list.size();
+    index = _palette_index(list.data(), count);
+    index_16 = _palette_index(list.data(), std::min<size_t>(count, 16));
+    index_8 = _palette_index(list.data(), std::min<size_t>(count, 8));
+  }
+
+  template <bool IS_FOREGROUND>
+  _color_code<IS_FOREGROUND> color(int r, int g, int b) const {
+    _clamp_rgb(r, g, b);
+    return {r,
+            g,
+            b,
+            index.find(r, g, b),
+            index_16.find(r, g, b),
+            index_8.find(r, g, b)};
+  }
+};
+
+} // namespace stc
@@ -0,0 +1,236 @@
+/*
+MIT License
+
+Copyright (c) 2024 illyigan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "stc.hpp"
+#include "stc_simd.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace stc {
+
+// Batch quantization of packed RGB pixels to 256 color codes. Every kernel
+// evaluates the same redmean distance as _color_distance, with the same
+// operation order, against the candidates described in _quantization_index
+// (bracketing cube levels plus the whole grey ramp), so results are identical
+// to _find_closest_color_code for every input.
+
+inline void _quantize_256_scalar(const uint8_t *rgb, size_t n,
+                                 uint8_t *codes_out) {
+  for (size_t i = 0; i < n; i++, rgb += 3)
+    codes_out[i] = (uint8_t)_find_closest_color_code(rgb[0], rgb[1], rgb[2]);
+}
+
+#ifdef STC_X86_KERNELS
+
+inline void _quantize_256_sse2(const uint8_t *rgb, size_t n,
+                               uint8_t *codes_out) {
+  const __m128 one = _mm_set1_ps(1), two = _mm_set1_ps(2),
+               four = _mm_set1_ps(4), half = _mm_set1_ps(0.5F),
+               inv256 = _mm_set1_ps(1.0F / 256), max = _mm_set1_ps(255);
+  auto select = [](__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+  };
+  auto level_index = [&](__m128 v) {
+    __m128 i = _mm_and_ps(_mm_cmpge_ps(v, _mm_set1_ps(95)), one);
+    i = _mm_add_ps(i, _mm_and_ps(_mm_cmpge_ps(v, _mm_set1_ps(135)), one));
+    i = _mm_add_ps(i, _mm_and_ps(_mm_cmpge_ps(v, _mm_set1_ps(175)), one));
+    return _mm_add_ps(i, _mm_and_ps(_mm_cmpge_ps(v, _mm_set1_ps(215)), one));
+  };
+  auto level = [&](__m128 i) {
+    const __m128 value =
+        _mm_add_ps(_mm_set1_ps(55), _mm_mul_ps(i, _mm_set1_ps(40)));
+    return _mm_and_ps(_mm_cmpgt_ps(i, _mm_setzero_ps()), value);
+  };
+  auto distance = [&](__m128 r, __m128 g, __m128 b, __m128 cr, __m128 cg,
+                      __m128 cb) {
+    const __m128 rd = _mm_sub_ps(cr, r), gd = _mm_sub_ps(cg, g),
+                 bd = _mm_sub_ps(cb, b);
+    const __m128 red_average = _mm_mul_ps(_mm_add_ps(r, cr), half);
+    const __m128 red = _mm_mul_ps(
+        _mm_add_ps(two, _mm_mul_ps(red_average, inv256)), _mm_mul_ps(rd, rd));
+    const __m128 green = _mm_mul_ps(four, _mm_mul_ps(gd, gd));
+    const __m128 blue = _mm_mul_ps(
+        _mm_add_ps(two, _mm_mul_ps(_mm_sub_ps(max, red_average), inv256)),
+        _mm_mul_ps(bd, bd));
+    return _mm_add_ps(_mm_add_ps(red, green), blue);
+  };
+
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4, rgb += 12) {
+    alignas(16) float in[3][4];
+    for (int lane = 0; lane < 4; lane++)
+      for (int c = 0; c < 3; c++)
+        in[c][lane] = rgb[(lane * 3) + c];
+    const __m128 r = _mm_load_ps(in[0]), g = _mm_load_ps(in[1]),
+                 b = _mm_load_ps(in[2]);
+    const __m128 ri = level_index(r), gi = level_index(g), bi = level_index(b);
+
+    __m128 best_distance = _mm_set1_ps(3.0e38F), best_code = _mm_setzero_ps();
+    auto consider = [&](__m128 d, __m128 code) {
+      const __m128 closer = _mm_cmplt_ps(d, best_distance);
+      best_distance = select(closer, d, best_distance);
+      best_code = select(closer, code, best_code);
+    };
+    for (int dr = 0; dr < 2; dr++)
+      for (int dg = 0; dg < 2; dg++)
+        for (int db = 0; db < 2; db++) {
+          const __m128 cri = _mm_add_ps(ri, _mm_set1_ps((float)dr)),
+                       cgi = _mm_add_ps(gi, _mm_set1_ps((float)dg)),
+                       cbi = _mm_add_ps(bi, _mm_set1_ps((float)db));
+          const __m128 code = _mm_add_ps(
+              _mm_add_ps(_mm_set1_ps(16), _mm_mul_ps(cri, _mm_set1_ps(36))),
+              _mm_add_ps(_mm_mul_ps(cgi, _mm_set1_ps(6)), cbi));
+          consider(distance(r, g, b, level(cri), level(cgi), level(cbi)), code);
+        }
+    for (int k = 0; k < 24; k++) {
+      const __m128 grey = _mm_set1_ps((float)(8 + (10 * k)));
+      consider(distance(r, g, b, grey, grey, grey),
+               _mm_set1_ps((float)(232 + k)));
+    }
+    const __m128 dark = _mm_and_ps(
+        _mm_cmplt_ps(r, _mm_set1_ps(20)),
+        _mm_and_ps(_mm_cmplt_ps(g, _mm_set1_ps(15)),
+                   _mm_cmplt_ps(b, _mm_set1_ps(15))));
+    best_code = select(dark, _mm_set1_ps(16), best_code);
+
+    alignas(16) int32_t out[4];
+    _mm_store_si128((__m128i *)out, _mm_cvtps_epi32(best_code));
+    for (int lane = 0; lane < 4; lane++)
+      codes_out[i + lane] = (uint8_t)out[lane];
+  }
+  _quantize_256_scalar(rgb, n - i, codes_out + i);
+}
+
+__attribute__((target("avx2"))) inline void
+_quantize_256_avx2(const uint8_t *rgb, size_t n, uint8_t *codes_out) {
+  const __m256 one = _mm256_set1_ps(1), two = _mm256_set1_ps(2),
+               four = _mm256_set1_ps(4), half = _mm256_set1_ps(0.5F),
+               inv256 = _mm256_set1_ps(1.0F / 256), max = _mm256_set1_ps(255);
+  auto level_index = [&](__m256 v) __attribute__((target("avx2"))) {
+    __m256 i = _mm256_and_ps(_mm256_cmp_ps(v, _mm256_set1_ps(95), _CMP_GE_OQ),
+                             one);
+    i = _mm256_add_ps(
+        i, _mm256_and_ps(_mm256_cmp_ps(v, _mm256_set1_ps(135), _CMP_GE_OQ),
+                         one));
+    i = _mm256_add_ps(
+        i, _mm256_and_ps(_mm256_cmp_ps(v, _mm256_set1_ps(175), _CMP_GE_OQ),
+                         one));
+    return _mm256_add_ps(
+        i, _mm256_and_ps(_mm256_cmp_ps(v, _mm256_set1_ps(215), _CMP_GE_OQ),
+                         one));
+  };
+  auto level = [&](__m256 i) __attribute__((target("avx2"))) {
+    const __m256 value = _mm256_add_ps(_mm256_set1_ps(55),
+                                       _mm256_mul_ps(i, _mm256_set1_ps(40)));
+    return _mm256_and_ps(
+        _mm256_cmp_ps(i, _mm256_setzero_ps(), _CMP_GT_OQ), value);
+  };
+  auto distance = [&](__m256 r, __m256 g, __m256 b, __m256 cr, __m256 cg,
+                      __m256 cb) __attribute__((target("avx2"))) {
+    const __m256 rd = _mm256_sub_ps(cr, r), gd = _mm256_sub_ps(cg, g),
+                 bd = _mm256_sub_ps(cb, b);
+    const __m256 red_average = _mm256_mul_ps(_mm256_add_ps(r, cr), half);
+    const __m256 red =
+        _mm256_mul_ps(_mm256_add_ps(two, _mm256_mul_ps(red_average, inv256)),
+                      _mm256_mul_ps(rd, rd));
+    const __m256 green = _mm256_mul_ps(four, _mm256_mul_ps(gd, gd));
+    const __m256 blue = _mm256_mul_ps(
+        _mm256_add_ps(two,
+                      _mm256_mul_ps(_mm256_sub_ps(max, red_average), inv256)),
+        _mm256_mul_ps(bd, bd));
+    return _mm256_add_ps(_mm256_add_ps(red, green), blue);
+  };
+
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8, rgb += 24) {
+    alignas(32) float in[3][8];
+    for (int lane = 0; lane < 8; lane++)
+      for (int c = 0; c < 3; c++)
+        in[c][lane] = rgb[(lane * 3) + c];
+    const __m256 r = _mm256_load_ps(in[0]), g = _mm256_load_ps(in[1]),
+                 b = _mm256_load_ps(in[2]);
+    const __m256 ri = level_index(r), gi = level_index(g),
+                 bi = level_index(b);
+
+    __m256 best_distance = _mm256_set1_ps(3.0e38F),
+           best_code = _mm256_setzero_ps();
+    auto consider = [&](__m256 d, __m256 code) __attribute__((target("avx2"))) {
+      const __m256 closer = _mm256_cmp_ps(d, best_distance, _CMP_LT_OQ);
+      best_distance = _mm256_blendv_ps(best_distance, d, closer);
+      best_code = _mm256_blendv_ps(best_code, code, closer);
+    };
+    for (int dr = 0; dr < 2; dr++)
+      for (int dg = 0; dg < 2; dg++)
+        for (int db = 0; db < 2; db++) {
+          const __m256 cri = _mm256_add_ps(ri, _mm256_set1_ps((float)dr)),
+                       cgi = _mm256_add_ps(gi, _mm256_set1_ps((float)dg)),
+                       cbi = _mm256_add_ps(bi, _mm256_set1_ps((float)db));
+          const __m256 code = _mm256_add_ps(
+              _mm256_add_ps(_mm256_set1_ps(16),
+                            _mm256_mul_ps(cri, _mm256_set1_ps(36))),
+              _mm256_add_ps(_mm256_mul_ps(cgi, _mm256_set1_ps(6)), cbi));
+          consider(distance(r, g, b, level(cri), level(cgi), level(cbi)), code);
+        }
+    for (int k = 0; k < 24; k++) {
+      const __m256 grey = _mm256_set1_ps((float)(8 + (10 * k)));
+      consider(distance(r, g, b, grey, grey, grey),
+               _mm256_set1_ps((float)(232 + k)));
+    }
+    const __m256 dark = _mm256_and_ps(
+        _mm256_cmp_ps(r, _mm256_set1_ps(20), _CMP_LT_OQ),
+        _mm256_and_ps(_mm256_cmp_ps(g, _mm256_set1_ps(15), _CMP_LT_OQ),
+                      _mm256_cmp_ps(b, _mm256_set1_ps(15), _CMP_LT_OQ)));
+    best_code = _mm256_blendv_ps(best_code, _mm256_set1_ps(16), dark);
+
+    alignas(32) int32_t out[8];
+    _mm256_store_si256((__m256i *)out, _mm256_cvtps_epi32(best_code));
+    for (int lane = 0; lane < 8; lane++)
+      codes_out[i + lane] = (uint8_t)out[lane];
+  }
+  _quantize_256_sse2(rgb, n - i, codes_out + i);
+}
+
+#endif
+
+using _quantize_256_kernel = void (*)(const uint8_t *, size_t, uint8_t *);
+
+inline _quantize_256_kernel _select_quantize_256_kernel() {
+#ifdef STC_X86_KERNELS
+  if (__builtin_cpu_supports("avx2"))
+    return _quantize_256_avx2;
+  return _quantize_256_sse2;
+#else
+  return _quantize_256_scalar;
+#endif
+}
+
+// quantizes n packed RGB pixels (3 bytes each) to 256 color codes, using the
+// widest kernel supported by the cpu
+inline void quantize_256(const uint8_t *rgb, size_t n, uint8_t *codes_out) {
+  static const _quantize_256_kernel kernel = _select_quantize_256_kernel();
+  kernel(rgb, n, codes_out);
+}
+
+} // namespace stc
@@ -0,0 +1,387 @@
+/*
+MIT License
+
+Copyright (c) 2024 illyigan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "stc.hpp"
+#include "stc_strip_ansi.hpp"
+#include <streambuf>
+
+namespace stc {
+
+class _sgr_color {
+public:
+  enum kind_type : unsigned char { DEFAULT, BASIC, INDEXED, RGB };
+  // BASIC: offset from 30/40 (0-7, 60-67), INDEXED: code in r, RGB: r, g, b
+  unsigned char kind = DEFAULT, r = 0, g = 0, b = 0;
+
+  constexpr bool operator==(const _sgr_color &other) const {
+    return kind == other.kind && r == other.r && g == other.g && b == other.b;
+  }
+  constexpr bool operator!=(const _sgr_color &other) const {
+    return !(*this == other);
+  }
+
+  template <size_t CAPACITY>
+  constexpr void append_to(_basic_sequence<CAPACITY> &params,
+                           bool is_foreground) const {
+    const int base = is_foreground ? 30 : 40;
+    if (kind == DEFAULT) {
+      params.append_number(base + 9);
+    } else if (kind == BASIC) {
+      params.append_number(base + r);
+    } else {
+      params.append_number(base + 8);
+      params.append(kind == INDEXED ? ";5;" : ";2;");
+      params.append_number(r);
+      if (kind == RGB) {
+        params.append(';');
+        params.append_number(g);
+        params.append(';');
+        params.append_number(b);
+      }
+    }
+  }
+};
+
+// The numbers of an SGR parameter list ("1;38;5;55"), empty ones are 0.
+// Values above 9999 are stored as 9999 and set truncated.
+class _sgr_parameters {
+public:
+  static constexpr int capacity = 32;
+  int values[capacity]{};
+  int count = 0;
+  bool truncated = false;
+
+  // returns false for bytes other than digits and ';', or for more than
+  // capacity parameters
+  constexpr bool parse(std::string_view parameters) {
+    count = 1;
+    values[0] = 0;
+    truncated = false;
+    for (const char c : parameters) {
+      if (c == ';') {
+        if (count == capacity)
+          return false;
+        values[count++] = 0;
+      } else if (c >= '0' && c <= '9') {
+        int &value = values[count - 1];
+        value = (value * 10) + (c - '0');
+        if (value > 9999) {
+          value = 9999;
+          truncated = true;
+        }
+      } else {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+// graphic rendition state of a terminal: colors and attributes 1-9
+class _sgr_state {
+public:
+  _sgr_color fg, bg;
+  unsigned short attributes = 0; // bit n is set while attribute n is active
+
+  constexpr bool operator==(const _sgr_state &other) const {
+    return fg == other.fg && bg == other.bg && attributes == other.attributes;
+  }
+  constexpr bool operator!=(const _sgr_state &other) const {
+    return !(*this == other);
+  }
+
+  // applies the parameters of an SGR sequence ("1;38;5;55"), returns false if
+  // some of them are not understood (those are ignored)
+  constexpr bool apply(std::string_view parameters) {
+    _sgr_parameters parsed;
+    if (!parsed.parse(parameters))
+      return false;
+    const int *const values = parsed.values;
+    const int count = parsed.count;
+    bool understood = true;
+    for (int i = 0; i < count; i++) {
+      const int p = values[i];
+      if (p == 0) {
+        *this = _sgr_state{};
+      } else if (p >= 1 && p <= 9) {
+        attributes |= (unsigned short)(1U << p);
+      } else if (p >= 22 && p <= 29 && p != 26) {
+        attributes &= (unsigned short)~_off_mask(p);
+      } else if ((p >= 30 && p <= 37) || (p >= 90 && p <= 97)) {
+        fg = {_sgr_color::BASIC, (unsigned char)(p - 30), 0, 0};
+      } else if ((p >= 40 && p <= 47) || (p >= 100 && p <= 107)) {
+        bg = {_sgr_color::BASIC, (unsigned char)(p - 40), 0, 0};
+      } else if (p == 39) {
+        fg = {};
+      } else if (p == 49) {
+        bg = {};
+      } else if (p == 38 || p == 48) {
+        _sgr_color &color = p == 38 ? fg : bg;
+        if (i + 2 < count && values[i + 1] == 5 && values[i + 2] < 256) {
+          color = {_sgr_color::INDEXED, (unsigned char)values[i + 2], 0, 0};
+          i += 2;
+        } else if (i + 4 < count && values[i + 1] == 2 &&
+                   values[i + 2] < 256 && values[i + 3] < 256 &&
+                   values[i + 4] < 256) {
+          color = {_sgr_color::RGB, (unsigned char)values[i + 2],
+                   (unsigned char)values[i + 3], (unsigned char)values[i + 4]};
+          i += 4;
+        } else {
+          return false;
+        }
+      } else {
+        understood = false;
+      }
+    }
+    return understood;
+  }
+
+  // appends the shortest parameter list that turns `from` into this state
+  template <size_t CAPACITY>
+  constexpr void append_change(_basic_sequence<CAPACITY> &params,
+                               const _sgr_state &from) const {
+    _basic_sequence<CAPACITY> reset, update;
+    _append_change(reset, _sgr_state{}, true);
+    _append_change(update, from, false);
+    params.append(update.size <= reset.size ? update.view() : reset.view());
+  }
+
+private:
+  // attributes cleared by an SGR 22-29 parameter
+  static constexpr unsigned _off_mask(int p) {
+    if (p == 22)
+      return (1U << 1) | (1U << 2);
+    if (p == 25)
+      return (1U << 5) | (1U << 6);
+    return 1U << (p - 20);
+  }
+
+  template <size_t CAPACITY>
+  constexpr void _append_change(_basic_sequence<CAPACITY> &params,
+                                const _sgr_state &from, bool reset) const {
+    auto separate = [&]() {
+      if (params.size != 0)
+        params.append(';');
+    };
+    if (reset)
+      params.append('0');
+    unsigned added = attributes & ~(unsigned)from.attributes;
+    const unsigned removed = from.attributes & ~(unsigned)attributes;
+    for (int p = 22; p <= 29; p++) {
+      if (p == 26 || (removed & _off_mask(p)) == 0)
+        continue;
+      separate();
+      params.append_number(p);
+      // 22 and 25 clear two attributes, restore the one that stays
+      added |= attributes & _off_mask(p);
+    }
+    for (int p = 1; p <= 9; p++) {
+      if ((added & (1U << p)) == 0)
+        continue;
+      separate();
+      params.append_number(p);
+    }
+    if (fg != from.fg) {
+      separate();
+      fg.append_to(params, true);
+    }
+    if (bg != from.bg) {
+      separate();
+      bg.append_to(params, false);
+    }
+  }
+};
+
+// The plumbing of the streambufs that rewrite control sequences: buffers the
+// input, splits it into text and escape sequences, and hands each complete
+// CSI sequence to rewrite_csi. Text, and sequences that are not rewritten,
+// are forwarded to the target after before_output. Sequences longer than 64
+// bytes are forwarded as they are.
+class _csi_rewriter : public std::streambuf {
+public:
+  _csi_rewriter(const _csi_rewriter &) = delete;
+  _csi_rewriter &operator=(const _csi_rewriter &) = delete;
+  ~_csi_rewriter() override {
+    if (installed_on != nullptr)
+      installed_on->rdbuf(target_buf);
+  }
+
+  std::streambuf *target() const { return target_buf; }
+
+protected:
+  explicit _csi_rewriter(std::streambuf *target) : target_buf(target) {
+    setp(input, input + sizeof(input));
+  }
+
+  // writes the output of os through this buffer until destroyed
+  void install(std::ostream &os) {
+    installed_on = &os;
+    os.rdbuf(this);
+  }
+
+  // called before output other than rewritten sequences is forwarded, and
+  // on sync outside of a sequence
+  virtual void before_output() {}
+  // returns true if the sequence "\033[" parameters final_byte was handled
+  // (possibly by emitting something else), false to forward it
+  virtual bool rewrite_csi(std::string_view parameters, char final_byte) = 0;
+
+  void emit(const char *data, size_t size) {
+    if (output_size + size > sizeof(output)) {
+      flush_output();
+      if (size > sizeof(output)) {
+        target_buf->sputn(data, (std::streamsize)size);
+        return;
+      }
+    }
+    std::char_traits<char>::copy(output + output_size, data, size);
+    output_size += size;
+  }
+  void emit(std::string_view text) { emit(text.data(), text.size()); }
+
+  int_type overflow(int_type c) override {
+    process(pbase(), (size_t)(pptr() - pbase()));
+    setp(input, input + sizeof(input));
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+      const char ch = traits_type::to_char_type(c);
+      process(&ch, 1);
+    }
+    return traits_type::not_eof(c);
+  }
+
+  int sync() override {
+    process(pbase(), (size_t)(pptr() - pbase()));
+    setp(input, input + sizeof(input));
+    if (parser == TEXT)
+      before_output();
+    flush_output();
+    return target_buf->pubsync();
+  }
+
+private:
+  enum parser_state { TEXT, ESCAPE, CSI };
+
+  std::streambuf *target_buf;
+  std::ostream *installed_on = nullptr;
+  parser_state parser = TEXT;
+  _basic_sequence<64> csi; // bytes after "\033[" of the current sequence
+  char input[1024];
+  char output[1024];
+  size_t output_size = 0;
+
+  void flush_output() {
+    target_buf->sputn(output, (std::streamsize)output_size);
+    output_size = 0;
+  }
+
+  void forward_csi(char final_byte) {
+    parser = TEXT;
+    before_output();
+    emit("\033[");
+    emit(csi.view());
+    emit(&final_byte, 1);
+  }
+
+  void process(const char *data, size_t size) {
+    const char *const end = data + size;
+    while (data != end) {
+      if (parser == TEXT) {
+        const char *const escape = _find_escape(data, end);
+        if (escape != data) {
+          before_output();
+          emit(data, (size_t)(escape - data));
+        }
+        data = escape;
+        if (data != end) {
+          parser = ESCAPE;
+          data++;
+        }
+      } else if (parser == ESCAPE) {
+        if (*data == '[') {
+          parser = CSI;
+          csi.size = 0;
+        } else {
+          parser = TEXT;
+          before_output();
+          emit("\033");
+          emit(data, 1);
+        }
+        data++;
+      } else {
+        const char c = *data++;
+        if (c >= 0x40 && c <= 0x7E) {
+          parser = TEXT;
+          if (!rewrite_csi(csi.view(), c))
+            forward_csi(c);
+        } else if (csi.size == sizeof(csi.data)) {
+          // not a sequence we can hold on to, pass it through
+          forward_csi(c);
+        } else {
+          csi.append(c);
+        }
+      }
+    }
+  }
+};
+
+// A filtering streambuf that tracks the graphic rendition state requested by
+// SGR sequences and forwards to the target only the changes that are still
+// in effect when text is written. Consecutive identical colors, styles that
+// are replaced before any text and resets followed by new colors collapse
+// into at most one sequence. Other escape sequences are passed through.
+//
+//   stc::sgr_filter filter(std::cout); // installs itself until destroyed
+class sgr_filter : public _csi_rewriter {
+public:
+  explicit sgr_filter(std::streambuf *target) : _csi_rewriter(target) {}
+  explicit sgr_filter(std::ostream &os) : sgr_filter(os.rdbuf()) {
+    install(os);
+  }
+  ~sgr_filter() override { sgr_filter::sync(); }
+
+protected:
+  // brings the terminal up to date with the requested state
+  void before_output() override {
+    if (terminal == pending)
+      return;
+    _basic_sequence<96> sequence;
+    sequence.append("\033[");
+    pending.append_change(sequence, terminal);
+    sequence.append('m');
+    emit(sequence.view());
+    terminal = pending;
+  }
+
+  // sequences with unknown parameters are replayed verbatim, once the
+  // terminal holds the state they were written over
+  bool rewrite_csi(std::string_view parameters, char final_byte) override {
+    return final_byte == 'm' && pending.apply(parameters);
+  }
+
+private:
+  _sgr_state terminal, pending;
+};
+
+} // namespace stc
@@ -0,0 +1,243 @@
+/*
+MIT License
+
+Copyright (c) 2024 illyigan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "stc.hpp"
+#include "stc_sgr_filter.hpp"
+#include <streambuf>
+
+namespace stc {
+
+// Remembers the codes of recently converted RGB colors. Direct mapped, a
+// color evicts the one stored in its slot.
+class _color_cache {
+public:
+  static constexpr unsigned slots = 1024;
+  stream_stats *counters = nullptr; // counts the lookups, if not null
+
+  // closest code in the given mode (256, 16 or 8 colors)
+  int find(int r, int g, int b, long mode) {
+    const auto key = ((uint32_t)r << 16) | ((uint32_t)g << 8) | (uint32_t)b;
+    const uint32_t slot = (key * 2654435761U) >> 22; // top 10 bits
+    if (keys[slot] == (key | valid)) {
+      _count_quantization(counters, true);
+      return codes[slot];
+    }
+    _count_quantization(counters, false);
+    int code = 0;
+    if (mode == _color_modes::COLOR_256) {
+      code = exact_code(r, g, b);
+      if (code < 0)
+        code = _find_closest_color_code(r, g, b);
+    } else {
+      int code_16 = 0, code_8 = 0;
+      _find_closest_system_color_codes(r, g, b, code_16, code_8);
+      code = mode == _color_modes::COLOR_16 ? code_16 : code_8;
+    }
+    keys[slot] = key | valid;
+    codes[slot] = (unsigned char)code;
+    return code;
+  }
+
+private:
+  static constexpr uint32_t valid = 1U << 24;
+
+  // code of a color of the cube or the grey ramp, so that 256 color output
+  // recorded in true color keeps its codes (even where the closest match
+  // differs, e.g. dark greys); -1 for other colors
+  static int exact_code(int r, int g, int b) {
+    auto level = [](int v) {
+      for (int i = 0; i < 6; i++)
+        if (_cube_levels[i] == v)
+          return i;
+      return -1;
+    };
+    const int i = level(r), j = level(g), k = level(b);
+    if (i >= 0 && j >= 0 && k >= 0)
+      return 16 + (36 * i) + (6 * j) + k;
+    if (r == g && g == b && r >= 8 && r <= 238 && (r - 8) % 10 == 0)
+      return 232 + ((r - 8) / 10);
+    return -1;
+  }
+  uint32_t keys[slots]{};
+  unsigned char codes[slots]{};
+};
+
+// Rewrites the color parameters of SGR sequences for another color mode:
+// "38;2;r;g;b" becomes "38;5;n" in 256 color mode or "3n"/"9n" in 16 and 8
+// color mode, and "38;5;n" becomes "38;2;r;g;b" in true color mode, with the
+// colors of _256colors. In no color mode SGR sequences are removed. Other
+// parameters are kept, sequences that can not be parsed are kept as they are.
+class _sgr_transcoder {
+public:
+  explicit _sgr_transcoder(_color_modes mode) : mode(mode) {}
+
+  _color_modes target_mode() const { return mode; }
+
+  // counts the quantizations of RGB colors in the given counters
+  void count_in(stream_stats *counters) { cache.counters = counters; }
+
+  // appends the rewritten sequence for the parameters of "\033[...m" to out,
+  // returns false if they are not understood
+  template <size_t CAPACITY>
+  bool rewrite(std::string_view parameters, _basic_sequence<CAPACITY> &out) {
+    if (mode == _color_modes::NO_COLOR)
+      return true;
+    if (parameters.empty()) {
+      out.append("\033[m");
+      return true;
+    }
+    _sgr_parameters parsed;
+    if (!parsed.parse(parameters) || parsed.truncated)
+      return false;
+    const int *const values = parsed.values;
+    const int count = parsed.count;
+    out.append("\033[");
+    for (int i = 0; i < count; i++) {
+      if (i != 0)
+        out.append(';');
+      const int p = values[i];
+      if (p == 38 || p == 48) {
+        const bool is_foreground = p == 38;
+        if (i + 2 < count && values[i + 1] == 5 && values[i + 2] < 256) {
+          const _color_data color = _256colors[values[i + 2]];
+          append_color(out, is_foreground, (int)color.r, (int)color.g,
+                       (int)color.b, values[i + 2]);
+          i += 2;
+        } else if (i + 4 < count && values[i + 1] == 2 &&
+                   values[i + 2] < 256 && values[i + 3] < 256 &&
+                   values[i + 4] < 256) {
+          append_color(out, is_foreground, values[i + 2], values[i + 3],
+                       values[i + 4], -1);
+          i += 4;
+        } else {
+          return false;
+        }
+      } else if (mode == _color_modes::COLOR_8 &&
+                 ((p >= 90 && p <= 97) || (p >= 100 && p <= 107))) {
+        // no bright colors in 8 color mode
+        out.append_number(p - 60);
+      } else {
+        out.append_number(p);
+      }
+    }
+    out.append('m');
+    return true;
+  }
+
+private:
+  _color_modes mode;
+  _color_cache cache;
+
+  // code is the 256 color code of the color, -1 if it is an RGB color
+  template <size_t CAPACITY>
+  void append_color(_basic_sequence<CAPACITY> &out, bool is_foreground, int r,
+                    int g, int b, int code) {
+    if (mode == _color_modes::TRUE_COLOR) {
+      out.append(is_foreground ? "38;2;" : "48;2;");
+      out.append_number(r);
+      out.append(';');
+      out.append_number(g);
+      out.append(';');
+      out.append_number(b);
+    } else if (mode == _color_modes::COLOR_256) {
+      out.append(is_foreground ? "38;5;" : "48;5;");
+      out.append_number(code >= 0 ? code : cache.find(r, g, b, mode));
+    } else {
+      // the system colors keep their code
+      const int closest =
+          code >= 0 && code < (mode == _color_modes::COLOR_16 ? 16 : 8)
+              ? code
+              : cache.find(r, g, b, mode);
+      const int offset = closest < 8 ? closest : 60 + (closest - 8);
+      out.append_number((is_foreground ? 30 : 40) + offset);
+    }
+  }
+};
+
+// A streambuf that transcodes the colors of SGR sequences written through it
+// to the color mode of the target, e.g. to replay output recorded in true
+// color mode on a terminal with 256 colors:
+//   std::cout << stc::color_256;
+//   stc::sgr_transcoder transcoder(std::cout); // installs itself
+//   std::cout << recorded_output;
+// Text and other escape sequences are passed through. Memory use is fixed,
+// sequences longer than 64 bytes are passed through as they are. Installed on
+// a stream, its quantizations are counted in stc::stats of the stream.
+class sgr_transcoder : public _csi_rewriter {
+public:
+  sgr_transcoder(std::streambuf *target, _color_modes mode)
+      : _csi_rewriter(target), transcoder(mode) {}
+  // transcodes to the color mode of os
+  explicit sgr_transcoder(std::ostream &os)
+      : sgr_transcoder(os.rdbuf(),
+                       (_color_modes)os.iword(_get_color_mode_index())) {
+    transcoder.count_in(_stats_of(os));
+    install(os);
+  }
+  ~sgr_transcoder() override { sgr_transcoder::sync(); }
+
+protected:
+  bool rewrite_csi(std::string_view parameters, char final_byte) override {
+    if (final_byte != 'm')
+      return false;
+    // "\033[" and 64 parameter bytes grow to at most 3 times their size
+    _basic_sequence<200> rewritten;
+    if (!transcoder.rewrite(parameters, rewritten))
+      return false;
+    emit(rewritten.view());
+    return true;
+  }
+
+private:
+  _sgr_transcoder transcoder;
+};
+
+// transcodes the SGR sequences of text to the given color mode
+inline std::string transcode_sgr(std::string_view text, _color_modes mode) {
+  std::string result;
+  class string_buffer : public std::streambuf {
+  public:
+    std::string *out = nullptr;
+
+  protected:
+    int_type overflow(int_type c) override {
+      if (!traits_type::eq_int_type(c, traits_type::eof()))
+        out->push_back(traits_type::to_char_type(c));
+      return traits_type::not_eof(c);
+    }
+    std::streamsize xsputn(const char *data, std::streamsize size) override {
+      out->append(data, (size_t)size);
+      return size;
+    }
+  } buffer;
+  buffer.out = &result;
+  {
+    sgr_transcoder transcoder(&buffer, mode);
+    transcoder.sputn(text.data(), (std::streamsize)text.size());
+  }
+  return result;
+}
+
+} // namespace stc
@@ -0,0 +1,252 @@
+/*
+MIT License
+
+Copyright (c) 2024 illyigan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "stc.hpp"
+#include "stc_simd.hpp"
+#include <cstring>
+#include <streambuf>
+
+namespace stc {
+
+// Searches for the next ESC byte, returns end if there is none. The kernels
+// compare 16 or 32 bytes at a time and test two vectors per iteration.
+
+inline const char *_find_escape_scalar(const char *data, const char *end) {
+  const void *escape = std::memchr(data, '\033', (size_t)(end - data));
+  return escape != nullptr ? static_cast<const char *>(escape) : end;
+}
+
+#ifdef STC_X86_KERNELS
+
+inline const char *_find_escape_sse2(const char *data, const char *end) {
+  const __m128i escape = _mm_set1_epi8('\033');
+  for (; end - data >= 32; data += 32) {
+    const __m128i low =
+        _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)data), escape);
+    const __m128i high =
+        _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(data + 16)), escape);
+    const unsigned mask = (unsigned)_mm_movemask_epi8(low) |
+                          ((unsigned)_mm_movemask_epi8(high) << 16);
+    if (mask != 0)
+      return data + __builtin_ctz(mask);
+  }
+  for (; data != end; data++)
+    if (*data == '\033')
+      return data;
+  return end;
+}
+
+__attribute__((target("avx2"))) inline const char *
+_find_escape_avx2(const char *data, const char *end) {
+  const __m256i escape = _mm256_set1_epi8('\033');
+  for (; end - data >= 64; data += 64) {
+    const __m256i low = _mm256_cmpeq_epi8(
+        _mm256_loadu_si256((const __m256i *)data), escape);
+    const __m256i high = _mm256_cmpeq_epi8(
+        _mm256_loadu_si256((const __m256i *)(data + 32)), escape);
+    if (_mm256_testz_si256(_mm256_or_si256(low, high),
+                           _mm256_or_si256(low, high)))
+      continue;
+    const auto mask =
+        (unsigned long long)(unsigned)_mm256_movemask_epi8(low) |
+        ((unsigned long long)(unsigned)_mm256_movemask_epi8(high) << 32);
+    return data + __builtin_ctzll(mask);
+  }
+  return _find_escape_sse2(data, end);
+}
+
+#endif
+
+using _find_escape_kernel = const char *(*)(const char *, const char *);
+
+inline _find_escape_kernel _select_find_escape_kernel() {
+#ifdef STC_X86_KERNELS
+  if (__builtin_cpu_supports("avx2"))
+    return _find_escape_avx2;
+  return _find_escape_sse2;
+#else
+  return _find_escape_scalar;
+#endif
+}
+
+inline const char *_find_escape(const char *data, const char *end) {
+  static const _find_escape_kernel kernel = _select_find_escape_kernel();
+  return kernel(data, end);
+}
+
+// Removes escape sequences from text that may arrive in pieces: CSI
+// sequences ("\033[1;38;5;55m", which include all SGR sequences), OSC strings
+// ("\033]8;;url\007", ended by BEL or "\033\\") and other escapes ("\0337",
+// "\033(B"). Text between sequences is passed on as views of the input, it is
+// never copied.
+class _ansi_stripper {
+public:
+  // calls write(std::string_view) with the text between sequences
+  template <class WRITE>
+  void feed(const char *data, size_t size, WRITE &&write) {
+    const char *const end = data + size;
+    while (data != end) {
+      if (state == TEXT) {
+        const char *const escape = _find_escape(data, end);
+        if (escape != data)
+          write(std::string_view(data, (size_t)(escape - data)));
+        data = escape;
+        if (data != end) {
+          state = ESCAPE;
+          data++;
+        }
+        continue;
+      }
+      if (state == CSI) {
+        // skip parameter and intermediate bytes (0x20 - 0x3F)
+        while (data != end && (unsigned char)(*data - 0x20) < 0x20)
+          data++;
+        if (data == end)
+          return;
+      }
+      const auto c = (unsigned char)*data++;
+      if (state == ESCAPE || state == CSI) {
+        if (c < 0x20 || c == 0x7F || c > 0x7E) {
+          // not part of a sequence (e.g. a newline after a lone ESC), the
+          // byte is kept
+          state = TEXT;
+          data--;
+        } else if (state == ESCAPE) {
+          // "\033(B" has intermediate bytes 0x20 - 0x2F before the final one
+          if (c == '[')
+            state = CSI;
+          else if (c == ']')
+            state = OSC;
+          else if (c > 0x2F)
+            state = TEXT;
+        } else if (c >= 0x40) {
+          // the final byte of a CSI sequence, after parameter and
+          // intermediate bytes in 0x20 - 0x3F
+          state = TEXT;
+        }
+      } else if (state == OSC) {
+        if (c == '\007')
+          state = TEXT;
+        else if (c == '\033')
+          state = OSC_ESCAPE;
+      } else {
+        state = c == '\\' ? TEXT : OSC;
+      }
+    }
+  }
+
+private:
+  enum parser_state : unsigned char { TEXT, ESCAPE, CSI, OSC, OSC_ESCAPE };
+  parser_state state = TEXT;
+};
+
+// Removes escape sequences from size bytes at data and writes the rest to
+// out, which may be data itself; returns the number of bytes written. Text
+// that is already in place is not moved, so a buffer without sequences is
+// only scanned.
+inline size_t strip_ansi(const char *data, size_t size, char *out) {
+  char *position = out;
+  _ansi_stripper stripper;
+  stripper.feed(data, size, [&](std::string_view text) {
+    if (text.data() != position)
+      std::memmove(position, text.data(), text.size());
+    position += text.size();
+  });
+  return (size_t)(position - out);
+}
+
+inline std::string strip_ansi(std::string_view text) {
+  std::string result(text.size(), '\0');
+  result.resize(strip_ansi(text.data(), text.size(), result.data()));
+  return result;
+}
+
+// A streambuf that removes escape sequences from everything written through
+// it, e.g. to store colored output in a log file:
+//   stc::strip_ansi_filter filter(log); // installs itself until destroyed
+// Sequences may be split between writes. Large writes are stripped straight
+// from the caller's buffer into the target.
+class strip_ansi_filter : public std::streambuf {
+public:
+  explicit strip_ansi_filter(std::streambuf *target) : target_buf(target) {
+    setp(input, input + sizeof(input));
+  }
+  explicit strip_ansi_filter(std::ostream &os)
+      : strip_ansi_filter(os.rdbuf()) {
+    installed_on = &os;
+    os.rdbuf(this);
+  }
+  strip_ansi_filter(const strip_ansi_filter &) = delete;
+  strip_ansi_filter &operator=(const strip_ansi_filter &) = delete;
+  ~strip_ansi_filter() override {
+    strip_ansi_filter::sync();
+    if (installed_on != nullptr)
+      installed_on->rdbuf(target_buf);
+  }
+
+  std::streambuf *target() const { return target_buf; }
+
+protected:
+  int_type overflow(int_type c) override {
+    process_input();
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+      const char ch = traits_type::to_char_type(c);
+      process(&ch, 1);
+    }
+    return traits_type::not_eof(c);
+  }
+
+  std::streamsize xsputn(const char *data, std::streamsize size) override {
+    if (size < epptr() - pptr())
+      return std::streambuf::xsputn(data, size);
+    process_input();
+    process(data, (size_t)size);
+    return size;
+  }
+
+  int sync() override {
+    process_input();
+    return target_buf->pubsync();
+  }
+
+private:
+  std::streambuf *target_buf;
+  std::ostream *installed_on = nullptr;
+  _ansi_stripper stripper;
+  char input[1024];
+
+  void process(const char *data, size_t size) {
+    stripper.feed(data, size, [&](std::string_view text) {
+      target_buf->sputn(text.data(), (std::streamsize)text.size());
+    });
+  }
+
+  void process_input() {
+    process(pbase(), (size_t)(pptr() - pbase()));
+    setp(input, input + sizeof(input));
+  }
+};
+
+} // namespace stc
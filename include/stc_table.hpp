@@ -0,0 +1,376 @@
+/*
+MIT License
+
+Copyright (c) 2024 illyigan
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "stc.hpp"
+#include "stc_simd.hpp"
+#include "stc_strip_ansi.hpp"
+#include <functional>
+#include <initializer_list>
+#include <vector>
+
+namespace stc {
+
+// Searches for the first byte that is not printable ASCII (0x20 - 0x7E),
+// returns end if there is none. Printable ASCII is one column per byte, so
+// only the bytes from there on need decoding.
+
+inline const char *_find_non_printable_scalar(const char *data,
+                                              const char *end) {
+  for (; data != end; data++)
+    if ((unsigned char)(*data - 0x20) >= 0x5F)
+      return data;
+  return end;
+}
+
+#ifdef STC_X86_KERNELS
+
+// as signed bytes, printable ASCII is greater than 0x1F, except 0x7F
+inline const char *_find_non_printable_sse2(const char *data,
+                                            const char *end) {
+  const __m128i space = _mm_set1_epi8(0x1F), del = _mm_set1_epi8(0x7F);
+  for (; end - data >= 16; data += 16) {
+    const __m128i bytes = _mm_loadu_si128((const __m128i *)data);
+    const __m128i printable = _mm_andnot_si128(_mm_cmpeq_epi8(bytes, del),
+                                               _mm_cmpgt_epi8(bytes, space));
+    const auto mask = (unsigned)_mm_movemask_epi8(printable);
+    if (mask != 0xFFFF)
+      return data + __builtin_ctz(~mask);
+  }
+  return _find_non_printable_scalar(data, end);
+}
+
+__attribute__((target("avx2"))) inline const char *
+_find_non_printable_avx2(const char *data, const char *end) {
+  const __m256i space = _mm256_set1_epi8(0x1F), del = _mm256_set1_epi8(0x7F);
+  for (; end - data >= 32; data += 32) {
+    const __m256i bytes = _mm256_loadu_si256((const __m256i *)data);
+    const __m256i printable = _mm256_andnot_si256(
+        _mm256_cmpeq_epi8(bytes, del), _mm256_cmpgt_epi8(bytes, space));
+    const auto mask = (unsigned)_mm256_movemask_epi8(printable);
+    if (mask != 0xFFFFFFFFU)
+      return data + __builtin_ctz(~mask);
+  }
+  return _find_non_printable_sse2(data, end);
+}
+
+#endif
+
+using _find_non_printable_kernel = const char *(*)(const char *, const char *);
+
+inline _find_non_printable_kernel _select_find_non_printable_kernel() {
+#ifdef STC_X86_KERNELS
+  if (__builtin_cpu_supports("avx2"))
+    return _find_non_printable_avx2;
+  return _find_non_printable_sse2;
+#else
+  return _find_non_printable_scalar;
+#endif
+}
+
+inline const char *_find_non_printable(const char *data, const char *end) {
+  static const _find_non_printable_kernel kernel =
+      _select_find_non_printable_kernel();
+  return kernel(data, end);
+}
+
+class _width_range {
+public:
+  uint32_t first, last;
+  int width;
+};
+
+// Code points that do not take one column, after wcwidth: combining marks and
+// other zero width characters, East Asian wide and fullwidth characters and
+// emoji (two columns). Sorted, the ranges cover the common blocks, not every
+// assignment of the Unicode tables.
+constexpr _width_range _width_ranges[] = {
+    {0x0300, 0x036F, 0}, {0x0483, 0x0489, 0}, {0x0591, 0x05BD, 0},
+    {0x0610, 0x061A, 0}, {0x064B, 0x065F, 0}, {0x0E31, 0x0E31, 0},
+    {0x0E34, 0x0E3A, 0}, {0x0E47, 0x0E4E, 0}, {0x1100, 0x115F, 2},
+    {0x1AB0, 0x1AFF, 0}, {0x1DC0, 0x1DFF, 0}, {0x200B, 0x200F, 0},
+    {0x2028, 0x202E, 0}, {0x2060, 0x2064, 0}, {0x20D0, 0x20FF, 0},
+    {0x231A, 0x231B, 2}, {0x2329, 0x232A, 2}, {0x23E9, 0x23EC, 2},
+    {0x23F0, 0x23F0, 2}, {0x23F3, 0x23F3, 2}, {0x25FD, 0x25FE, 2},
+    {0x2614, 0x2615, 2}, {0x2648, 0x2653, 2}, {0x26AA, 0x26AB, 2},
+    {0x26BD, 0x26BE, 2}, {0x26C4, 0x26C5, 2}, {0x26D4, 0x26D4, 2},
+    {0x26EA, 0x26EA, 2}, {0x26F2, 0x26F5, 2}, {0x26FA, 0x26FD, 2},
+    {0x2705, 0x2705, 2}, {0x270A, 0x270B, 2}, {0x2728, 0x2728, 2},
+    {0x274C, 0x274C, 2}, {0x2753, 0x2755, 2}, {0x2757, 0x2757, 2},
+    {0x2795, 0x2797, 2}, {0x27B0, 0x27B0, 2}, {0x27BF, 0x27BF, 2},
+    {0x2B1B, 0x2B1C, 2}, {0x2B50, 0x2B50, 2}, {0x2B55, 0x2B55, 2},
+    {0x2E80, 0x303E, 2}, {0x3041, 0x33FF, 2}, {0x3400, 0x4DBF, 2},
+    {0x4E00, 0x9FFF, 2}, {0xA000, 0xA4CF, 2}, {0xA960, 0xA97F, 2},
+    {0xAC00, 0xD7A3, 2}, {0xF900, 0xFAFF, 2}, {0xFE00, 0xFE0F, 0},
+    {0xFE10, 0xFE19, 2}, {0xFE20, 0xFE2F, 0}, {0xFE30, 0xFE6F, 2},
+    {0xFEFF, 0xFEFF, 0}, {0xFF00, 0xFF60, 2}, {0xFFE0, 0xFFE6, 2},
+    {0x1F004, 0x1F004, 2}, {0x1F0CF, 0x1F0CF, 2}, {0x1F18E, 0x1F18E, 2},
+    {0x1F191, 0x1F19A, 2}, {0x1F200, 0x1F251, 2}, {0x1F300, 0x1F64F, 2},
+    {0x1F680, 0x1F6FF, 2}, {0x1F7E0, 0x1F7EB, 2}, {0x1F900, 0x1F9FF, 2},
+    {0x1FA70, 0x1FAFF, 2}, {0x20000, 0x2FFFD, 2}, {0x30000, 0x3FFFD, 2},
+    {0xE0100, 0xE01EF, 0}};
+
+// columns taken by a code point
+constexpr int _code_point_width(uint32_t c) {
+  if (c < 0x0300)
+    return c < 0x20 || (c >= 0x7F && c < 0xA0) ? 0 : 1;
+  // binary search for the last range starting at or before c
+  size_t low = 0, high = std::size(_width_ranges);
+  while (high - low > 1) {
+    const size_t middle = (low + high) / 2;
+    if (_width_ranges[middle].first <= c)
+      low = middle;
+    else
+      high = middle;
+  }
+  const _width_range &range = _width_ranges[low];
+  return c >= range.first && c <= range.last ? range.width : 1;
+}
+
+// columns taken by text without escape sequences, decoded as UTF-8 (a byte
+// that does not start a valid sequence takes one column)
+inline size_t _text_width(const char *data, const char *end) {
+  size_t width = 0;
+  while (data != end) {
+    if ((unsigned char)*data < 0x80) {
+      const char *const stop = _find_non_printable(data, end);
+      width += (size_t)(stop - data);
+      data = stop;
+      if (data == end)
+        break;
+      // control characters take no columns
+      if ((unsigned char)*data < 0x80) {
+        data++;
+        continue;
+      }
+    }
+    const auto lead = (unsigned char)*data;
+    size_t length = 1;
+    uint32_t c = lead;
+    if (lead >= 0xC2 && lead < 0xE0)
+      length = 2, c = lead & 0x1F;
+    else if (lead >= 0xE0 && lead < 0xF0)
+      length = 3, c = lead & 0x0F;
+    else if (lead >= 0xF0 && lead < 0xF5)
+      length = 4, c = lead & 0x07;
+    bool valid = length > 1 && length <= (size_t)(end - data);
+    for (size_t k = 1; valid && k < length; k++) {
+      const auto byte = (unsigned char)data[k];
+      valid = (byte & 0xC0) == 0x80;
+      c = (c << 6) | (byte & 0x3F);
+    }
+    if (!valid) {
+      width++;
+      data++;
+      continue;
+    }
+    width += (size_t)_code_point_width(c);
+    data += length;
+  }
+  return width;
+}
+
+// Columns taken by text on a terminal: escape sequences (colors, styles and
+// other CSI, OSC and escape sequences) take none, UTF-8 is decoded and wide
+// characters take two. Runs of printable ASCII are counted 16 or 32 bytes at
+// a time.
+inline size_t display_width(std::string_view text) {
+  const char *const end = text.data() + text.size();
+  const char *const stop = _find_non_printable(text.data(), end);
+  if (stop == end)
+    return text.size();
+  size_t width = (size_t)(stop - text.data());
+  _ansi_stripper stripper;
+  stripper.feed(stop, (size_t)(end - stop), [&](std::string_view piece) {
+    width += _text_width(piece.data(), piece.data() + piece.size());
+  });
+  return width;
+}
+
+// Remembers the widths of recently measured texts that are not plain ASCII,
+// so that repeated contents (status words, colored labels) are only decoded
+// once. Direct mapped, a text evicts the one stored in its slot; plain ASCII
+// is counted faster than it could be looked up.
+class width_cache {
+public:
+  static constexpr size_t slots = 256;
+
+  size_t width(std::string_view text) {
+    const char *const end = text.data() + text.size();
+    if (_find_non_printable(text.data(), end) == end)
+      return text.size();
+    const size_t hash = std::hash<std::string_view>{}(text);
+    entry &slot = entries[hash % slots];
+    if (slot.hash == hash && slot.text == text) {
+      hit_count++;
+      return slot.width;
+    }
+    miss_count++;
+    slot.hash = hash;
+    slot.text.assign(text.data(), text.size());
+    slot.width = display_width(text);
+    return slot.width;
+  }
+
+  size_t hits() const { return hit_count; }
+  size_t misses() const { return miss_count; }
+
+private:
+  struct entry {
+    size_t hash = 0;
+    std::string text;
+    size_t width = 0;
+  };
+  std::vector<entry> entries = std::vector<entry>(slots);
+  size_t hit_count = 0, miss_count = 0;
+};
+
+// Rows of styled cells laid out in columns padded to the widest cell:
+//   stc::table t;
+//   t.set_style(0, stc::style(stc::bold));
+//   t.set_alignment(1, stc::table::RIGHT);
+//   t.add_row({"cpu", "97%"});
+//   t.add_row({"memory", colored_text}); // may contain escape sequences
+//   std::cout << t;
+// Widths are measured with display_width when a row is added and kept with
+// the cell, repeated contents are measured once (see width_cache), so
+// rendering again only copies and pads. A column style covers the padding
+// and is rendered for the color mode of the stream, it is written again
+// before the padding after a cell with escape sequences (which may reset
+// it).
+class table {
+public:
+  enum alignment { LEFT, RIGHT, CENTER };
+
+  // text between columns
+  void set_separator(std::string_view text) { separator.assign(text); }
+  void set_alignment(size_t column, alignment align) {
+    column_at(column).align = align;
+  }
+  void set_style(size_t column, const style &s) {
+    column_at(column).column_style = s;
+    column_at(column).has_style = true;
+  }
+
+  // cells are text that may contain escape sequences
+  void add_row(std::initializer_list<std::string_view> cells) {
+    add_row(cells.begin(), cells.end());
+  }
+  void add_row(const std::vector<std::string> &cells) {
+    add_row(cells.begin(), cells.end());
+  }
+  template <class ITERATOR> void add_row(ITERATOR begin, ITERATOR end) {
+    row_begin.push_back(cells.size());
+    for (size_t column = 0; begin != end; ++begin, column++) {
+      const std::string_view text = *begin;
+      const size_t width = widths.width(text);
+      const bool has_escape = text.find('\033') != std::string_view::npos;
+      cells.push_back({std::string(text), width, has_escape});
+      column_at(column).width = std::max(column_at(column).width, width);
+    }
+  }
+
+  size_t rows() const { return row_begin.size(); }
+  size_t columns() const { return column_info.size(); }
+  // width of the widest cell of a column
+  size_t column_width(size_t column) const { return column_info[column].width; }
+
+  void clear_rows() {
+    cells.clear();
+    row_begin.clear();
+    for (column &c : column_info)
+      c.width = 0;
+  }
+
+  // appends the rows, each ended by '\n', in the given color mode (no escape
+  // sequences at all in NO_COLOR mode, including the ones in cells)
+  void render(std::string &out, _color_modes mode) const {
+    for (size_t row = 0; row < row_begin.size(); row++) {
+      const size_t first = row_begin[row];
+      const size_t last =
+          row + 1 < row_begin.size() ? row_begin[row + 1] : cells.size();
+      for (size_t i = first; i < last; i++) {
+        const column &c = column_info[i - first];
+        const size_t padding = c.width - cells[i].width;
+        size_t left = 0;
+        if (c.align == RIGHT)
+          left = padding;
+        else if (c.align == CENTER)
+          left = padding / 2;
+        if (i != first)
+          out.append(separator);
+        if (c.has_style)
+          out.append(c.column_style.sequence(mode));
+        out.append(left, ' ');
+        if (mode == _color_modes::NO_COLOR)
+          out.append(strip_ansi(cells[i].text));
+        else
+          out.append(cells[i].text);
+        // the last column is not padded on the right
+        if (i + 1 != last || c.has_style) {
+          if (c.has_style && cells[i].has_escape && padding != left)
+            out.append(c.column_style.sequence(mode));
+          out.append(padding - left, ' ');
+        }
+        if (c.has_style && mode != _color_modes::NO_COLOR)
+          out.append("\033[0m");
+      }
+      out.push_back('\n');
+    }
+  }
+
+private:
+  struct cell {
+    std::string text;
+    size_t width;
+    bool has_escape;
+  };
+  struct column {
+    size_t width = 0;
+    alignment align = LEFT;
+    style column_style;
+    bool has_style = false;
+  };
+
+  std::vector<cell> cells;       // row by row
+  std::vector<size_t> row_begin; // position of the first cell of each row
+  std::vector<column> column_info;
+  std::string separator = "  ";
+  width_cache widths;
+
+  column &column_at(size_t position) {
+    if (position >= column_info.size())
+      column_info.resize(position + 1);
+    return column_info[position];
+  }
+};
+
+// writes the table with a single write in the color mode of the stream
+inline std::ostream &operator<<(std::ostream &os, const table &t) {
+  std::string output;
+  t.render(output, (_color_modes)os.iword(_get_color_mode_index()));
+  return os.write(output.data(), (std::streamsize)output.size());
+}
+
+} // namespace stc
@@ -0,0 +1,90 @@
+#include "check.hpp"
+#include "stc_async_writer.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+// Writes many short colored lines through a small ring to a pipe that is
+// read slowly. With every policy the lines that come out must be whole, with
+// BLOCK all of them.
+
+std::string expected_line(int line) {
+  std::ostringstream os;
+  os << stc::true_color << stc::rgb_fg(95, 21, 191) << "line " << line
+     << stc::reset << " ok\n";
+  return os.str();
+}
+
+std::string write_lines(stc::async_writer::backpressure policy, int lines) {
+  int fds[2];
+  if (::pipe(fds) != 0)
+    std::abort();
+#ifdef F_SETPIPE_SZ
+  ::fcntl(fds[1], F_SETPIPE_SZ, 4096);
+#endif
+  std::string output;
+  std::thread reader([&output, fd = fds[0]]() {
+    char chunk[1024];
+    ssize_t size;
+    while ((size = ::read(fd, chunk, sizeof(chunk))) > 0) {
+      output.append(chunk, (size_t)size);
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+  });
+  {
+    stc::async_writer writer(fds[1], 300, policy);
+    std::ostream os(&writer);
+    os << stc::true_color;
+    for (int i = 0; i < lines; i++) {
+      os << stc::rgb_fg(95, 21, 191) << "line " << i << stc::reset << " ok";
+      // put() writes into the put area without a call while it has room
+      if (i % 2 == 0)
+        os.put('\n');
+      else
+        os << '\n';
+    }
+  }
+  ::close(fds[1]);
+  reader.join();
+  ::close(fds[0]);
+  return output;
+}
+
+// returns the number of lines, -1 if one is not whole or out of order
+int count_whole_lines(const std::string &output) {
+  std::istringstream is(output);
+  std::string line;
+  int count = 0, next = 0;
+  while (std::getline(is, line)) {
+    line += '\n';
+    const size_t at = line.find("line ");
+    if (at == std::string::npos)
+      return -1;
+    const int number = std::atoi(line.c_str() + at + 5);
+    if (number < next || line != expected_line(number))
+      return -1;
+    next = number + 1;
+    count++;
+  }
+  return count;
+}
+
+int main() {
+  const int lines = 20000;
+  const std::string all = write_lines(stc::async_writer::BLOCK, lines);
+  CHECK(count_whole_lines(all) == lines);
+
+  const std::string dropped = write_lines(stc::async_writer::DROP, lines);
+  CHECK(count_whole_lines(dropped) > 0);
+  CHECK(dropped.empty() || dropped.back() == '\n');
+
+  const std::string coalesced =
+      write_lines(stc::async_writer::COALESCE, lines);
+  CHECK(count_whole_lines(coalesced) > 0);
+  CHECK(coalesced.empty() || coalesced.back() == '\n');
+  return check_result();
+}
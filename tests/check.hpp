@@ -0,0 +1,22 @@
+#pragma once
+#include <cstdio>
+
+// The tests are plain programs: CHECK prints each failed condition, and main
+// returns check_result() so that ctest reports the failure.
+
+inline int check_failures = 0;
+
+#define CHECK(condition)                                                       \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__,    \
+                   #condition);                                                \
+      check_failures++;                                                        \
+    }                                                                          \
+  } while (false)
+
+inline int check_result() {
+  if (check_failures != 0)
+    std::fprintf(stderr, "%d checks failed\n", check_failures);
+  return check_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,30 @@
+#include "check.hpp"
+#include "stc.hpp"
+#include <cstdio>
+
+// The quantization index finds the same 256 color code as the exhaustive
+// scan of the table, over a strided sample of the RGB cube (every third
+// value of each channel, 0 and 255 included) and at compile time.
+
+static_assert(stc::_find_closest_color_code(95, 21, 191) ==
+              stc::_find_closest_color_code_exhaustive(95, 21, 191));
+static_assert(stc::_find_closest_color_code(128, 128, 129) ==
+              stc::_find_closest_color_code_exhaustive(128, 128, 129));
+
+int main() {
+  int mismatches = 0;
+  for (int r = 0; r < 256; r += 3)
+    for (int g = 0; g < 256; g += 3)
+      for (int b = 0; b < 256; b += 3) {
+        const int code = stc::_find_closest_color_code(r, g, b);
+        const int expected = stc::_find_closest_color_code_exhaustive(r, g, b);
+        if (code != expected && mismatches++ < 10)
+          std::fprintf(stderr, "rgb(%d, %d, %d) is %d instead of %d\n", r, g,
+                       b, code, expected);
+      }
+  CHECK(mismatches == 0);
+  // out of range values fall back to the scan
+  CHECK(stc::_find_closest_color_code(300, -5, 128) ==
+        stc::_find_closest_color_code_exhaustive(300, -5, 128));
+  return check_result();
+}
@@ -0,0 +1,35 @@
+#include "check.hpp"
+#include "stc_dither.hpp"
+#include <cstdint>
+#include <vector>
+
+// Both dithering methods give the same codes with any number of threads,
+// including more threads than rows, as on the calling thread alone.
+
+int main() {
+  // an odd size, a smooth gradient with some noise
+  const size_t width = 123, height = 37;
+  std::vector<uint8_t> pixels;
+  uint32_t state = 1;
+  for (size_t y = 0; y < height; y++)
+    for (size_t x = 0; x < width; x++) {
+      state = (state * 1103515245U) + 12345U;
+      const int noise = (int)((state >> 16) & 7);
+      pixels.push_back((uint8_t)(x * 2));
+      pixels.push_back((uint8_t)((y * 6) + noise));
+      pixels.push_back((uint8_t)(200 - x + noise));
+    }
+
+  for (const stc::dither_method method : {stc::BAYER, stc::FLOYD_STEINBERG}) {
+    std::vector<uint8_t> expected(width * height);
+    stc::dither_256(pixels.data(), width, height, expected.data(), method);
+    for (const unsigned threads : {1U, 2U, 3U, 4U, 7U, 64U}) {
+      stc::thread_pool pool(threads);
+      std::vector<uint8_t> codes(width * height);
+      stc::dither_256(pixels.data(), width, height, codes.data(), method,
+                      pool);
+      CHECK(codes == expected);
+    }
+  }
+  return check_result();
+}
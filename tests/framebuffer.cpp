@@ -0,0 +1,34 @@
+#include "check.hpp"
+#include "stc_framebuffer.hpp"
+#include <string>
+
+// present() writes only the cells that changed since the previous frame,
+// moving the cursor over the others.
+
+std::string present(stc::framebuffer &screen, stc::_color_modes mode) {
+  std::string out;
+  screen.present(out, mode);
+  return out;
+}
+
+int main() {
+  stc::framebuffer screen(4, 2);
+  // the first frame is written in full
+  CHECK(present(screen, stc::COLOR_256) == "\033[H    \033[2;1H    ");
+  CHECK(present(screen, stc::COLOR_256).empty());
+
+  screen.print(1, 0, "ab", stc::code_fg(1));
+  CHECK(present(screen, stc::COLOR_256) == "\033[1;2H\033[38;5;1mab\033[0m");
+
+  // a NUL is a space, which is unchanged here, the cursor moves over it
+  screen.print(0, 1, std::string_view("x\0y", 3));
+  CHECK(present(screen, stc::COLOR_256) == "\033[2;1Hx\033[Cy");
+
+  // cells outside of the frame are skipped, UTF-8 glyphs take one cell
+  screen.print(-1, 1, "zz\xE2\x96\x80zz");
+  CHECK(present(screen, stc::COLOR_256) == "\033[2;1Hz\xE2\x96\x80zz");
+
+  // a new color mode writes the frame again
+  CHECK(present(screen, stc::NO_COLOR) == "\033[H ab \033[2;1Hz\xE2\x96\x80zz");
+  return check_result();
+}
@@ -0,0 +1,61 @@
+#define STC_ENABLE_STATS
+#include "check.hpp"
+#include "stc_gradient.hpp"
+#include <sstream>
+#include <string>
+
+// A gradient writes the sequence of each color change before the character
+// it starts at, the same sequence as rgb_fg writes for that color, in every
+// color mode.
+
+// "abc" from red to blue is red, (128, 0, 128) and blue
+std::string expected(long mode) {
+  const stc::_color_code<true> colors[] = {stc::rgb_fg(255, 0, 0),
+                                           stc::rgb_fg(128, 0, 128),
+                                           stc::rgb_fg(0, 0, 255)};
+  std::string result;
+  std::string_view last;
+  for (int i = 0; i < 3; i++) {
+    const std::string_view sequence = colors[i].sequence(mode);
+    if (sequence != last)
+      result.append(sequence);
+    last = sequence;
+    result += (char)('a' + i);
+  }
+  return result;
+}
+
+int main() {
+  const stc::gradient red_to_blue =
+      stc::gradient::rgb({{255, 0, 0}, {0, 0, 255}});
+  const long modes[] = {stc::COLOR_256, stc::TRUE_COLOR, stc::NO_COLOR,
+                        stc::COLOR_16, stc::COLOR_8};
+  for (const long mode : modes) {
+    std::string appended;
+    stc::append(appended, red_to_blue.fg("abc"), (stc::_color_modes)mode);
+    CHECK(appended == expected(mode));
+  }
+  CHECK(expected(stc::TRUE_COLOR) == "\033[38;2;255;0;0ma"
+                                     "\033[38;2;128;0;128mb"
+                                     "\033[38;2;0;0;255mc");
+  CHECK(expected(stc::NO_COLOR) == "abc");
+
+  // the colored text outlives the gradient it was made from
+  const auto black = stc::gradient::rgb({{0, 0, 0}, {0, 0, 0}}).bg("xy");
+  std::ostringstream os;
+  os << stc::true_color << black;
+  CHECK(os.str() == "\033[48;2;0;0;0mxy");
+
+  // sequences are not placed inside a UTF-8 character
+  std::string utf8;
+  stc::append(utf8, red_to_blue.fg("\xC3\xA9\xC3\xA9"), stc::TRUE_COLOR);
+  CHECK(utf8 == "\033[38;2;255;0;0m\xC3\xA9\033[38;2;0;0;255m\xC3\xA9");
+
+  // sequences are counted where they are written, not from the text
+  std::ostringstream counted;
+  counted << stc::true_color
+          << stc::gradient::rgb({{9, 9, 9}, {9, 9, 9}}).fg("\033[1mx");
+  CHECK(counted.str() == "\033[38;2;9;9;9m\033[1mx");
+  CHECK(stc::stats(counted).sequences[stc::stream_stats::COLOR] == 1);
+  return check_result();
+}
@@ -0,0 +1,42 @@
+#include "check.hpp"
+#include "stc_highlight.hpp"
+#include <sstream>
+#include <string>
+
+// writes text to a highlighter in the given pieces, returns its output
+template <class... PIECES>
+std::string highlight(std::initializer_list<stc::highlight_rule> rules,
+                      const PIECES &...pieces) {
+  std::ostringstream target;
+  {
+    stc::highlighter h(target.rdbuf(), rules, stc::_color_modes::COLOR_256);
+    std::ostream os(&h);
+    (os << ... << pieces);
+  }
+  return target.str();
+}
+
+int main() {
+  const stc::style red = stc::code_fg(1), blue = stc::code_fg(4);
+  CHECK(highlight({{"ERROR", red}}, "an ERROR here\n") ==
+        "an \033[38;5;1mERROR\033[0m here\n");
+  // a keyword split between writes
+  CHECK(highlight({{"ERROR", red}}, "an ERR", "OR here\n") ==
+        "an \033[38;5;1mERROR\033[0m here\n");
+  // the match that starts first wins, then the longest
+  CHECK(highlight({{"ab", red}, {"abc", blue}, {"bcd", red}}, "abcd") ==
+        "\033[38;5;4mabc\033[0md");
+  // escape sequences are never matched
+  CHECK(highlight({{"ERROR", red}}, "\033[1mERROR\033[0m") ==
+        "\033[1m\033[38;5;1mERROR\033[0m\033[0m");
+
+  // "A" is found at the end of the first buffer of 1024 bytes, while "aAAA",
+  // which starts before it and replaces it, is only complete in the second
+  const std::string text = std::string(1021, 'x') + "aAAA\n";
+  CHECK(highlight({{"A", red}, {"aAAA", blue}}, text) ==
+        std::string(1021, 'x') + "\033[38;5;4maAAA\033[0m\n");
+  CHECK(highlight({{"A", red}, {"aAAA", blue}}, std::string(1021, 'x'),
+                  "aA", "AA\n") ==
+        std::string(1021, 'x') + "\033[38;5;4maAAA\033[0m\n");
+  return check_result();
+}
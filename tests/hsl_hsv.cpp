@@ -0,0 +1,94 @@
+#include "check.hpp"
+#include "stc.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+// The fixed-point conversions, one at a time and in batches, are within 1
+// per channel of the float conversions over a dense sweep of the inputs.
+// hsl_fg and hsl_bg use the fixed-point conversion at runtime.
+
+// (https://en.wikipedia.org/wiki/HSL_and_HSV#HSV_to_RGB_alternative)
+void hsv_reference(float h, float s, float v, int &r, int &g, int &b) {
+  auto f = [=](double n) {
+    const double k = std::fmod(n + (h * 6.0), 6.0);
+    const double t = std::max(0.0, std::min({k, 4 - k, 1.0}));
+    return (int)std::lround((v - (v * s * t)) * 255);
+  };
+  r = f(5), g = f(3), b = f(1);
+}
+
+bool within_one(const int *a, const uint8_t *b) {
+  for (int c = 0; c < 3; c++)
+    if (std::abs(a[c] - (int)b[c]) > 1)
+      return false;
+  return true;
+}
+
+int main() {
+  const int steps = 128;
+  std::vector<float> inputs;
+  for (int i = 0; i <= steps; i++)
+    for (int j = 0; j <= steps; j++)
+      for (int k = 0; k <= steps; k++) {
+        inputs.push_back((float)i / steps);
+        inputs.push_back((float)j / steps);
+        inputs.push_back((float)k / steps);
+      }
+  const size_t n = inputs.size() / 3;
+  std::vector<uint8_t> hsl(3 * n), hsv(3 * n);
+  stc::hsl_to_rgb(inputs.data(), n, hsl.data());
+  stc::hsv_to_rgb(inputs.data(), n, hsv.data());
+
+  int hsl_errors = 0, hsv_errors = 0, batch_errors = 0;
+  for (size_t i = 0; i < n; i++) {
+    const float x = inputs[3 * i], y = inputs[(3 * i) + 1],
+                z = inputs[(3 * i) + 2];
+    int expected[3], fixed[3];
+    stc::_hsl_to_rgb(x, y, z, expected[0], expected[1], expected[2]);
+    hsl_errors += !within_one(expected, &hsl[3 * i]);
+    stc::_hsl_to_rgb_fixed(x, y, z, fixed[0], fixed[1], fixed[2]);
+    for (int c = 0; c < 3; c++)
+      batch_errors += fixed[c] != hsl[(3 * i) + c];
+
+    hsv_reference(x, y, z, expected[0], expected[1], expected[2]);
+    hsv_errors += !within_one(expected, &hsv[3 * i]);
+    stc::_hsv_to_rgb_fixed(x, y, z, fixed[0], fixed[1], fixed[2]);
+    for (int c = 0; c < 3; c++)
+      batch_errors += fixed[c] != hsv[(3 * i) + c];
+  }
+  CHECK(hsl_errors == 0);
+  CHECK(hsv_errors == 0);
+  CHECK(batch_errors == 0); // the batches match the single conversions
+
+  // hues wrap around, other components are clamped
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  const float odd[] = {1.25F, 0.5F, 0.5F, -0.75F, 0.5F, 0.5F,
+                       0.25F, 2.0F, -1.0F, 1e30F,  nan,  0.5F};
+  uint8_t out[12];
+  stc::hsl_to_rgb(odd, 4, out);
+  int r = 0, g = 0, b = 0;
+  stc::_hsl_to_rgb_fixed(0.25F, 0.5F, 0.5F, r, g, b);
+  CHECK(out[0] == r && out[1] == g && out[2] == b);
+  CHECK(std::abs(out[3] - r) <= 1 && std::abs(out[4] - g) <= 1 &&
+        std::abs(out[5] - b) <= 1);
+  stc::_hsl_to_rgb_fixed(0.25F, 1.0F, 0.0F, r, g, b);
+  CHECK(out[6] == r && out[7] == g && out[8] == b);
+  // huge hues are whole numbers, NaN is clamped to 0 or 1
+  CHECK(out[9] == 255 && out[10] == 0 && out[11] == 0);
+
+  // hsl_fg and hsl_bg convert with floats in constant expressions and in
+  // fixed point at runtime, a lightness of 0.1 is 25.5 and rounds apart
+  constexpr auto constant_fg = stc::hsl_fg(0.0F, 0.0F, 0.1F);
+  constexpr auto constant_bg = stc::hsl_bg(0.0F, 0.0F, 0.1F);
+  static_assert(constant_fg.r == 26 && constant_bg.b == 26);
+  volatile float lightness = 0.1F;
+  stc::_hsl_to_rgb_fixed(0.0F, 0.0F, lightness, r, g, b);
+  const auto runtime_fg = stc::hsl_fg(0.0F, 0.0F, lightness);
+  const auto runtime_bg = stc::hsl_bg(0.0F, 0.0F, lightness);
+  CHECK(runtime_fg.r == r && runtime_fg.g == g && runtime_fg.b == b);
+  CHECK(runtime_bg.r == r && runtime_bg.g == g && runtime_bg.b == b);
+  CHECK(r == 25);
+  return check_result();
+}
@@ -0,0 +1,63 @@
+#include "check.hpp"
+#include "stc_log_sink.hpp"
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Many threads write colored lines through one sink, piece by piece: every
+// line of the target must come out whole, and the lines of each thread in
+// the order they were written.
+
+std::string expected_line(int thread, int line) {
+  std::ostringstream os;
+  os << stc::true_color << stc::rgb_fg(95, 21, 191) << "[worker " << thread
+     << "]" << stc::reset << " item " << line << ' ' << stc::code_fg(34)
+     << "ok" << stc::reset << '\n';
+  return os.str();
+}
+
+int main() {
+  const int threads = 8, lines = 2000;
+  std::ostringstream target;
+  target << stc::true_color;
+  {
+    stc::log_sink sink(target);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++)
+      workers.emplace_back([&sink, t]() {
+        for (int i = 0; i < lines; i++) {
+          std::ostream &os = sink.stream();
+          os << stc::rgb_fg(95, 21, 191) << "[worker " << t << "]"
+             << stc::reset << " item " << i << ' ' << stc::code_fg(34)
+             << "ok" << stc::reset << '\n';
+        }
+      });
+    for (auto &worker : workers)
+      worker.join();
+  }
+
+  std::vector<int> next(threads, 0);
+  std::istringstream output(target.str());
+  std::string line;
+  int count = 0;
+  bool whole = true;
+  while (std::getline(output, line)) {
+    line += '\n';
+    count++;
+    // the thread is the digit after "[worker "
+    const size_t at = line.find("[worker ");
+    const int t = at == std::string::npos ? -1 : line[at + 8] - '0';
+    if (t < 0 || t >= threads || next[t] >= lines ||
+        line != expected_line(t, next[t])) {
+      whole = false;
+      continue;
+    }
+    next[t]++;
+  }
+  CHECK(whole);
+  CHECK(count == threads * lines);
+  for (int t = 0; t < threads; t++)
+    CHECK(next[t] == lines);
+  return check_result();
+}
@@ -0,0 +1,42 @@
+#include "check.hpp"
+#include "stc.hpp"
+#include <sstream>
+#include <string>
+
+// What the stream operators write in each color mode.
+
+template <class T> std::string written(std::ostream &(*mode)(std::ostream &),
+                                       const T &value) {
+  std::ostringstream os;
+  os << mode << value;
+  return os.str();
+}
+
+int main() {
+  const auto purple = stc::rgb_fg(95, 21, 191);
+  CHECK(written(stc::color_256, purple) == "\033[38;5;55m");
+  CHECK(written(stc::true_color, purple) == "\033[38;2;95;21;191m");
+  CHECK(written(stc::no_color, purple).empty());
+  CHECK(written(stc::color_16, stc::rgb_bg(255, 0, 0)) == "\033[101m");
+  CHECK(written(stc::color_8, stc::rgb_bg(255, 0, 0)) == "\033[41m");
+  CHECK(written(stc::color_256, stc::code_bg(17)) == "\033[48;5;17m");
+  // system codes given with the color (by stc::palette) are kept
+  const stc::_color_code<true> given(0, 0, 0, 16, 9, 1);
+  CHECK(written(stc::color_16, given) == "\033[91m");
+  CHECK(written(stc::color_8, given) == "\033[31m");
+
+  CHECK(written(stc::color_256, stc::bold) == "\033[1m");
+  CHECK(written(stc::no_color, stc::reset).empty());
+
+  const stc::style warning = purple | stc::code_bg(17) | stc::style(stc::bold);
+  CHECK(written(stc::color_256, warning) == "\033[1;38;5;55;48;5;17m");
+  CHECK(written(stc::no_color, warning).empty());
+
+  // the color mode is kept per stream
+  std::ostringstream a, b;
+  a << stc::true_color << purple;
+  b << purple;
+  CHECK(a.str() == "\033[38;2;95;21;191m");
+  CHECK(b.str() == "\033[38;5;55m");
+  return check_result();
+}
@@ -0,0 +1,70 @@
+#include "check.hpp"
+#include "stc_palette.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+
+// The grid index of a palette finds the same color as a scan of the whole
+// list (the first of equally close colors), on every third value of each
+// channel, for the full list and its first 16 and 8 colors.
+
+int scan(const std::vector<uint8_t> &rgb, size_t count, int r, int g, int b) {
+  int best = 0;
+  float best_distance = 0;
+  for (size_t i = 0; i < count; i++) {
+    const stc::_color_data color(rgb[3 * i], rgb[(3 * i) + 1],
+                                 rgb[(3 * i) + 2], (int)i);
+    const float distance = stc::_color_distance(r, g, b, color);
+    if (i == 0 || distance < best_distance) {
+      best = (int)i;
+      best_distance = distance;
+    }
+  }
+  return best;
+}
+
+int main() {
+  // 200 pseudo-random colors, with a repeated one to test ties
+  std::vector<uint8_t> rgb;
+  uint32_t state = 12345;
+  for (int i = 0; i < 3 * 200; i++) {
+    state = (state * 1103515245U) + 12345U;
+    rgb.push_back((uint8_t)(state >> 16));
+  }
+  for (int c = 0; c < 3; c++)
+    rgb[(3 * 5) + c] = rgb[(3 * 2) + c];
+  const stc::palette p(rgb.data(), 200);
+  CHECK(p.size() == 200);
+
+  int mismatches = 0;
+  std::vector<uint8_t> pixels, codes;
+  for (int r = 0; r < 256; r += 3)
+    for (int g = 0; g < 256; g += 3)
+      for (int b = 0; b < 256; b += 3) {
+        const int code = p.find(r, g, b), expected = scan(rgb, 200, r, g, b);
+        if (code != expected && mismatches++ < 10)
+          std::fprintf(stderr, "rgb(%d, %d, %d) is %d instead of %d\n", r, g,
+                       b, code, expected);
+        const auto color = p.rgb_fg(r, g, b);
+        mismatches += color.code != code;
+        mismatches += color.code_16 != scan(rgb, 16, r, g, b);
+        mismatches += color.code_8 != scan(rgb, 8, r, g, b);
+        pixels.insert(pixels.end(), {(uint8_t)r, (uint8_t)g, (uint8_t)b});
+        codes.push_back((uint8_t)code);
+      }
+  CHECK(mismatches == 0);
+  std::vector<uint8_t> quantized(codes.size());
+  p.quantize(pixels.data(), codes.size(), quantized.data());
+  CHECK(quantized == codes);
+  CHECK(p.find(rgb[6], rgb[7], rgb[8]) == 2); // not the later copy, 5
+
+  bool threw = false;
+  try {
+    stc::palette empty(rgb.data(), 0);
+  } catch (const std::invalid_argument &) {
+    threw = true;
+  }
+  CHECK(threw);
+  return check_result();
+}
@@ -0,0 +1,46 @@
+#include "check.hpp"
+#include "stc.hpp"
+#include <cstdio>
+
+// The k-d tree search of perceptual matching finds the same code as trying
+// every palette color, on every third value of each channel.
+
+int brute_force(const stc::_perceptual_index &index, int r, int g, int b) {
+  const stc::_oklab query = stc::_rgb_to_oklab(index.linear, r, g, b);
+  float best_distance = 1e30F;
+  int best_code = 256;
+  for (int i = 0; i < 240; i++) {
+    const float dl = index.colors[i].l - query.l,
+                da = index.colors[i].a - query.a,
+                db = index.colors[i].b - query.b;
+    const float distance = (dl * dl) + (da * da) + (db * db);
+    if (distance < best_distance ||
+        (distance == best_distance && index.codes[i] < best_code)) {
+      best_distance = distance;
+      best_code = index.codes[i];
+    }
+  }
+  return best_code;
+}
+
+int main() {
+  const stc::_perceptual_index &index = stc::_256color_perceptual_index<>;
+  int mismatches = 0;
+  for (int r = 0; r < 256; r += 3)
+    for (int g = 0; g < 256; g += 3)
+      for (int b = 0; b < 256; b += 3) {
+        const int code = index.find(r, g, b);
+        const int expected = brute_force(index, r, g, b);
+        if (code != expected && mismatches++ < 10)
+          std::fprintf(stderr, "rgb(%d, %d, %d) is %d instead of %d\n", r, g,
+                       b, code, expected);
+      }
+  CHECK(mismatches == 0);
+  // the palette colors find themselves
+  for (int code = 16; code < 256; code++) {
+    const auto color = stc::_256colors[code];
+    CHECK(stc::rgb_fg<stc::PERCEPTUAL>(color.r, color.g, color.b).code ==
+          code);
+  }
+  return check_result();
+}
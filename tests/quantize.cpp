@@ -0,0 +1,51 @@
+#include "check.hpp"
+#include "stc_quantize.hpp"
+#include <cstdint>
+#include <vector>
+
+// Every kernel of quantize_256 gives the same codes as the scalar path for
+// all 16M RGB inputs, checked one red value (65536 pixels) at a time.
+
+using kernel = void (*)(const uint8_t *, size_t, uint8_t *);
+
+void check_kernel(const char *name, kernel quantize) {
+  std::vector<uint8_t> rgb(256 * 256 * 3);
+  std::vector<uint8_t> expected(256 * 256), codes(256 * 256);
+  int mismatches = 0;
+  for (int r = 0; r < 256; r++) {
+    for (int i = 0; i < 256 * 256; i++) {
+      rgb[(3 * i) + 0] = (uint8_t)r;
+      rgb[(3 * i) + 1] = (uint8_t)(i >> 8);
+      rgb[(3 * i) + 2] = (uint8_t)i;
+    }
+    stc::_quantize_256_scalar(rgb.data(), expected.size(), expected.data());
+    quantize(rgb.data(), codes.size(), codes.data());
+    for (size_t i = 0; i < codes.size(); i++)
+      if (codes[i] != expected[i] && mismatches++ < 10)
+        std::fprintf(stderr, "%s: rgb(%d, %d, %d) is %d instead of %d\n",
+                     name, r, (int)(i >> 8), (int)(i & 255), codes[i],
+                     expected[i]);
+  }
+  CHECK(mismatches == 0);
+
+  // lengths that end inside a vector, the rest goes to a narrower kernel
+  for (size_t n = 0; n <= 17; n++) {
+    std::vector<uint8_t> tail(n + 1, 0xAA);
+    quantize(rgb.data() + (3 * 1000), n, tail.data());
+    for (size_t i = 0; i < n; i++)
+      CHECK(tail[i] == expected[1000 + i]);
+    CHECK(tail[n] == 0xAA);
+  }
+}
+
+int main() {
+  check_kernel("quantize_256", stc::quantize_256);
+#ifdef STC_X86_KERNELS
+  check_kernel("sse2", stc::_quantize_256_sse2);
+  if (__builtin_cpu_supports("avx2"))
+    check_kernel("avx2", stc::_quantize_256_avx2);
+  else
+    std::fprintf(stderr, "avx2 is not supported, its kernel is not tested\n");
+#endif
+  return check_result();
+}
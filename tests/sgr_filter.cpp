@@ -0,0 +1,46 @@
+#include "check.hpp"
+#include "stc_sgr_filter.hpp"
+#include <sstream>
+#include <string>
+
+// what sgr_filter forwards for the given input
+std::string filtered(const std::string &input) {
+  std::stringbuf target;
+  {
+    stc::sgr_filter filter(&target);
+    filter.sputn(input.data(), (std::streamsize)input.size());
+  }
+  return target.str();
+}
+
+int main() {
+  // repeated and overridden sequences collapse into the state in effect
+  CHECK(filtered("\033[31ma\033[31mb") == "\033[31mab");
+  CHECK(filtered("\033[1m\033[0m\033[32mx") == "\033[32mx");
+  CHECK(filtered("\033[38;5;55mx\033[0m") == "\033[38;5;55mx\033[0m");
+  CHECK(filtered("\033[1mx\033[0;1my") == "\033[1mxy");
+  // other escape sequences are passed through
+  CHECK(filtered("\033[2Jx") == "\033[2Jx");
+
+  // 32 parameters are parsed, more are passed through as they are
+  CHECK(filtered("\033[" + std::string(31, ';') + "1mx") == "\033[1mx");
+  for (const size_t separators : {32, 33, 40, 62, 63, 64, 100}) {
+    const std::string sequence =
+        "\033[" + std::string(separators, ';') + "1m";
+    CHECK(filtered(sequence + "x") == sequence + "x");
+  }
+  const std::string numbers = "\033[1;2;3;4;5;6;7;8;9;1;2;3;4;5;6;7;8;9;1;2;3;"
+                              "4;5;6;7;8;9;1;2;3;4;5;6m";
+  CHECK(filtered(numbers + "x") == numbers + "x");
+
+  stc::_sgr_parameters parameters;
+  CHECK(parameters.parse("1;;38;5;123456"));
+  CHECK(parameters.count == 5);
+  CHECK(parameters.values[1] == 0 && parameters.values[4] == 9999);
+  CHECK(parameters.truncated);
+  CHECK(parameters.parse(std::string(31, ';')));
+  CHECK(parameters.count == 32);
+  CHECK(!parameters.parse(std::string(32, ';')));
+  CHECK(!parameters.parse("1;a"));
+  return check_result();
+}
@@ -0,0 +1,34 @@
+#include "check.hpp"
+#include "stc_sgr_transcoder.hpp"
+#include <string>
+
+using stc::transcode_sgr;
+
+int main() {
+  CHECK(transcode_sgr("\033[1;38;2;95;21;191mx", stc::COLOR_256) ==
+        "\033[1;38;5;55mx");
+  CHECK(transcode_sgr("\033[48;5;17mx", stc::TRUE_COLOR) ==
+        "\033[48;2;0;0;95mx");
+  CHECK(transcode_sgr("\033[38;2;255;0;0mx", stc::COLOR_16) == "\033[91mx");
+  CHECK(transcode_sgr("\033[91;38;2;255;0;0mx", stc::COLOR_8) ==
+        "\033[31;31mx");
+  CHECK(transcode_sgr("\033[1mx\033[0m", stc::NO_COLOR) == "x");
+  // other sequences and values that do not fit are kept as they are
+  CHECK(transcode_sgr("\033[2J\033[38;5;300mx", stc::TRUE_COLOR) ==
+        "\033[2J\033[38;5;300mx");
+  CHECK(transcode_sgr("\033[1;123456mx", stc::COLOR_256) ==
+        "\033[1;123456mx");
+
+  // 32 parameters are rewritten, more are passed through as they are
+  std::string zeros;
+  for (int i = 0; i < 31; i++)
+    zeros += "0;";
+  CHECK(transcode_sgr("\033[" + std::string(31, ';') + "1m", stc::COLOR_256) ==
+        "\033[" + zeros + "1m");
+  for (const size_t separators : {32, 33, 40, 62, 63, 64, 100}) {
+    const std::string sequence =
+        "\033[" + std::string(separators, ';') + "38;2;1;2;3mx";
+    CHECK(transcode_sgr(sequence, stc::COLOR_256) == sequence);
+  }
+  return check_result();
+}
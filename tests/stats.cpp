@@ -0,0 +1,38 @@
+#define STC_ENABLE_STATS
+#include "check.hpp"
+#include "stc.hpp"
+#include <locale>
+#include <sstream>
+
+int main() {
+  std::ostringstream os;
+  os << stc::rgb_fg(95, 21, 191) << stc::bold << "text" << stc::no_color
+     << stc::reset;
+  CHECK(stc::stats(os).sequences[stc::stream_stats::COLOR] == 1);
+  CHECK(stc::stats(os).sequences[stc::stream_stats::ATTRIBUTE] == 1);
+  CHECK(stc::stats(os).escape_bytes == 14);
+  CHECK(stc::stats(os).suppressed == 1);
+
+  // imbue keeps the counters
+  const stc::stream_stats *const counters = &stc::stats(os);
+  os.imbue(std::locale::classic());
+  CHECK(&stc::stats(os) == counters);
+  CHECK(stc::stats(os).escape_bytes == 14);
+
+  // a stream that copies the format counts on its own
+  std::ostringstream copy;
+  copy.copyfmt(os);
+  CHECK(&stc::stats(copy) != counters);
+  CHECK(stc::stats(copy).escape_bytes == 0);
+  copy << stc::color_256 << stc::code_fg(17);
+  CHECK(stc::stats(copy).escape_bytes == 10);
+  CHECK(stc::stats(os).escape_bytes == 14);
+
+  // copying the format again replaces the counters of the copy
+  copy.copyfmt(os);
+  CHECK(stc::stats(copy).escape_bytes == 0);
+
+  stc::reset_stats(os);
+  CHECK(stc::stats(os).escape_bytes == 0);
+  return check_result();
+}
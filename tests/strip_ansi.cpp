@@ -0,0 +1,74 @@
+#include "check.hpp"
+#include "stc_strip_ansi.hpp"
+#include <sstream>
+#include <string>
+
+// The escape search kernels find the same byte as the scalar loop for an ESC
+// at every offset of every length up to 130 (and none at all), from every
+// alignment. strip_ansi_filter removes sequences split anywhere between
+// writes.
+
+using kernel = const char *(*)(const char *, const char *);
+
+int check_kernel(kernel find) {
+  int mismatches = 0;
+  alignas(64) char buffer[64 + 131];
+  for (size_t align = 0; align < 64; align += 7)
+    for (size_t length = 0; length <= 130; length++)
+      for (size_t escape = 0; escape <= length; escape++) {
+        char *const data = buffer + align;
+        for (size_t i = 0; i < length; i++)
+          data[i] = (char)('a' + (i % 26)); // ESC is 0x1B, not in 'a' - 'z'
+        if (escape != length)
+          data[escape] = '\033';
+        // an ESC past the end must not be found
+        data[length] = '\033';
+        mismatches += find(data, data + length) !=
+                      stc::_find_escape_scalar(data, data + length);
+      }
+  return mismatches;
+}
+
+std::string filtered(const std::string &text, size_t split) {
+  std::ostringstream target;
+  {
+    stc::strip_ansi_filter filter(target);
+    target << text.substr(0, split) << std::flush << text.substr(split);
+  }
+  return target.str();
+}
+
+int main() {
+  CHECK(check_kernel(stc::_find_escape_scalar) == 0);
+#ifdef STC_X86_KERNELS
+  CHECK(check_kernel(stc::_find_escape_sse2) == 0);
+  if (__builtin_cpu_supports("avx2"))
+    CHECK(check_kernel(stc::_find_escape_avx2) == 0);
+#endif
+
+  const std::string text = "a\033[1;38;5;55mb\033]8;;http://x\007c"
+                           "\033]0;title\033\\d\0337e\033(Bf\033[0m";
+  CHECK(stc::strip_ansi(text) == "abcdef");
+  for (size_t split = 0; split <= text.size(); split++)
+    CHECK(filtered(text, split) == "abcdef");
+
+  // one byte at a time
+  std::ostringstream target;
+  {
+    stc::strip_ansi_filter filter(target);
+    for (const char c : text)
+      target << c << std::flush;
+  }
+  CHECK(target.str() == "abcdef");
+
+  // large writes bypass the buffer, with a sequence split between two
+  const std::string large(2000, 'x');
+  const std::string split_csi = large + "\033[38;5;", rest = "55m" + large;
+  std::ostringstream large_target;
+  {
+    stc::strip_ansi_filter filter(large_target);
+    large_target << split_csi << rest;
+  }
+  CHECK(large_target.str() == large + large);
+  return check_result();
+}
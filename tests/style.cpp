@@ -0,0 +1,71 @@
+#include "check.hpp"
+#include "stc.hpp"
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+// Attributes combine with | among themselves and with colors, at compile
+// time through stc::attribute, and are plain manipulator functions.
+
+constexpr stc::style title =
+    stc::attribute<stc::bold> | stc::attribute<stc::underline>;
+constexpr stc::style label = stc::attribute<stc::bold> |
+                             stc::attribute<stc::underline> |
+                             stc::rgb_fg(95, 21, 191);
+static_assert(title.sequence(stc::COLOR_256) == "\033[1;4m");
+static_assert(label.sequence(stc::COLOR_256) == "\033[1;4;38;5;55m");
+static_assert(
+    (stc::rgb_fg(95, 21, 191) | stc::attribute<stc::bold> | stc::code_bg(17))
+        .sequence(stc::TRUE_COLOR) == "\033[1;38;2;95;21;191;48;2;0;0;95m");
+static_assert((stc::attribute<stc::bold> | stc::attribute<stc::reset> |
+               stc::attribute<stc::italic>)
+                  .sequence(stc::COLOR_256) == "\033[0;3m");
+static_assert(stc::attribute<stc::reset_fg>.sequence(stc::COLOR_256) ==
+              "\033[39m");
+
+// the parts of a style can be read back
+static_assert(label.has_fg() && !label.has_bg());
+static_assert(label.fg_color().code == 55);
+static_assert(label.attribute_bits() == ((1U << 1) | (1U << 4)));
+static_assert(!stc::attribute<stc::reset_fg>.has_fg());
+
+// the attributes are functions like any other manipulator
+static_assert(std::is_same_v<decltype(&stc::bold), stc::_manipulator>);
+template <class T> constexpr bool deduced_manipulator(T) {
+  return std::is_same_v<T, std::ostream &(*)(std::ostream &)>;
+}
+static_assert(deduced_manipulator(stc::italic));
+
+int main() {
+  std::ostringstream os;
+  os << stc::bold << label << stc::reset;
+  CHECK(os.str() == "\033[1m\033[1;4;38;5;55m\033[0m");
+
+  // the same styles from the functions at runtime
+  const stc::style runtime_label =
+      stc::style(stc::bold) | stc::underline | stc::rgb_fg(95, 21, 191);
+  CHECK(runtime_label.sequence(stc::COLOR_256) ==
+        label.sequence(stc::COLOR_256));
+  CHECK((stc::rgb_fg(1, 2, 3) | stc::reset_fg).sequence(stc::COLOR_256) ==
+        "\033[39m");
+  // manipulators that are not attributes are ignored
+  CHECK(stc::style(stc::true_color).sequence(stc::COLOR_256).empty());
+
+  // called directly, or through a pointer
+  std::ostringstream called;
+  stc::underline(called);
+  const stc::_manipulator manipulator = &stc::inverse;
+  manipulator(called);
+  CHECK(called.str() == "\033[4m\033[7m");
+
+  std::ostringstream fixed;
+  stc::styled_ostream<stc::TRUE_COLOR> out(fixed);
+  out << stc::faint << "x" << (stc::style(stc::faint) | stc::rgb_bg(1, 2, 3));
+  CHECK(fixed.str() == "\033[2mx\033[2;48;2;1;2;3m");
+
+  std::string appended;
+  stc::append(appended, stc::crossed_out, stc::COLOR_256);
+  stc::append(appended, stc::crossed_out, stc::NO_COLOR);
+  CHECK(appended == "\033[9m");
+  return check_result();
+}
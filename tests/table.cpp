@@ -0,0 +1,56 @@
+#include "check.hpp"
+#include "stc_table.hpp"
+#include <string>
+
+// display_width skips escape sequences and counts wide characters twice, and
+// a table pads its columns to the widest cell by that width.
+
+std::string rendered(const stc::table &t, stc::_color_modes mode) {
+  std::string out;
+  t.render(out, mode);
+  return out;
+}
+
+int main() {
+  CHECK(stc::display_width("") == 0);
+  CHECK(stc::display_width("abc") == 3);
+  CHECK(stc::display_width("\xE6\xBC\xA2\xE5\xAD\x97") == 4); // 漢字
+  CHECK(stc::display_width("\xF0\x9F\x98\x80") == 2);         // emoji
+  CHECK(stc::display_width("e\xCC\x81") == 1); // combining accent
+  CHECK(stc::display_width("\033[38;5;2mab\033]8;;http://x\033\\c\033[0m") ==
+        3);
+  // long enough for the vector kernels, with the wide character at the end
+  CHECK(stc::display_width(std::string(40, 'a') + "\xE6\xBC\xA2") == 42);
+  CHECK(stc::display_width(std::string(40, 'a') + "\033[1m" +
+                           std::string(40, 'b')) == 80);
+
+  stc::width_cache cache;
+  CHECK(cache.width("\xE6\xBC\xA2") == 2);
+  CHECK(cache.width("\xE6\xBC\xA2") == 2);
+  CHECK(cache.hits() == 1 && cache.misses() == 1);
+
+  stc::table t;
+  t.set_separator("|");
+  t.set_alignment(1, stc::table::RIGHT);
+  t.set_alignment(2, stc::table::CENTER);
+  t.add_row({"a", "\xE6\xBC\xA2\xE5\xAD\x97", "x"});
+  t.add_row({"abc", "b", "\033[31mred\033[0m"});
+  CHECK(t.column_width(0) == 3 && t.column_width(1) == 4 &&
+        t.column_width(2) == 3);
+  CHECK(rendered(t, stc::COLOR_256) ==
+        "a  |\xE6\xBC\xA2\xE5\xAD\x97| x\n"
+        "abc|   b|\033[31mred\033[0m\n");
+  CHECK(rendered(t, stc::NO_COLOR) == "a  |\xE6\xBC\xA2\xE5\xAD\x97| x\n"
+                                      "abc|   b|red\n");
+
+  // a column style covers the padding, also after a cell that resets it
+  stc::table styled;
+  styled.set_style(0, stc::code_fg(2));
+  styled.add_row({"\033[1mab\033[0m", "z"});
+  styled.add_row({"abcd", "y"});
+  CHECK(rendered(styled, stc::COLOR_256) ==
+        "\033[38;5;2m\033[1mab\033[0m\033[38;5;2m  \033[0m  z\n"
+        "\033[38;5;2mabcd\033[0m  y\n");
+  CHECK(rendered(styled, stc::NO_COLOR) == "ab    z\nabcd  y\n");
+  return check_result();
+}